@@ -0,0 +1,10 @@
+#include "async_search_server.h"
+
+using namespace std;
+
+future<SearchResult> AsyncSearchServer::FindTopDocuments(string raw_query, Clock::time_point deadline,
+                                                         shared_ptr<const atomic<bool>> cancelled) {
+    return FindTopDocuments(move(raw_query), [](int document_id, DocumentStatus status, int rating) {
+        return status == DocumentStatus::ACTUAL;
+        }, deadline, move(cancelled));
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+#include "query_deadline.h"
+#include "search_server.h"
+#include "thread_pool.h"
+
+struct SearchResult {
+    std::vector<Document> documents;
+    // дедлайн истёк или запрос отменён раньше, чем были просмотрены все списки документов
+    bool is_partial = false;
+};
+
+// Асинхронные запросы к SearchServer на собственном пуле потоков. Запрос, не уложившийся
+// в дедлайн, не держит вызывающий поток и возвращает лучшие из уже найденных документов.
+// Как и RequestQueue, хранит ссылку на сервер: менять сервер во время запросов нельзя
+class AsyncSearchServer {
+public:
+    using Clock = QueryDeadline::Clock;
+
+    explicit AsyncSearchServer(const SearchServer& search_server,
+                               size_t thread_count = std::max(1u, std::thread::hardware_concurrency()))
+        : search_server_(search_server)
+        , thread_pool_(thread_count) {
+    }
+
+    // cancelled - необязательный флаг отмены, который вызывающий может выставить в любой момент
+    template <typename DocumentPredicate>
+    std::future<SearchResult> FindTopDocuments(std::string raw_query, DocumentPredicate document_predicate,
+                                               Clock::time_point deadline,
+                                               std::shared_ptr<const std::atomic<bool>> cancelled = nullptr);
+
+    std::future<SearchResult> FindTopDocuments(std::string raw_query, Clock::time_point deadline,
+                                               std::shared_ptr<const std::atomic<bool>> cancelled = nullptr);
+
+private:
+    const SearchServer& search_server_;
+    ThreadPool thread_pool_;
+};
+
+template <typename DocumentPredicate>
+std::future<SearchResult> AsyncSearchServer::FindTopDocuments(std::string raw_query, DocumentPredicate document_predicate,
+                                                              Clock::time_point deadline,
+                                                              std::shared_ptr<const std::atomic<bool>> cancelled) {
+    return thread_pool_.Submit([this, raw_query = std::move(raw_query), document_predicate, deadline, cancelled] {
+        const QueryDeadline query_deadline(deadline, cancelled.get());
+        SearchResult result;
+        // дедлайн мог истечь, пока запрос стоял в очереди
+        if (!query_deadline.Check()) {
+            result.documents = search_server_.FindTopDocuments(std::execution::seq, raw_query, document_predicate, query_deadline);
+        }
+        result.is_partial = query_deadline.IsExpired();
+        return result;
+    });
+}
@@ -0,0 +1,257 @@
+// Нагрузочный бенчмарк поискового сервера на синтетическом корпусе.
+// Собирается отдельно от main.cpp, параметры корпуса задаются аргументами:
+// ./benchmark --documents=10000 --vocabulary=20000 --query-words=3 --minus-ratio=0.1
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+#include "simd_kernels.h"
+#include "synthetic_corpus.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <execution>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+class LatencyRecorder {
+public:
+    explicit LatencyRecorder(string name)
+        : name_(move(name)) {
+    }
+
+    template <typename Operation>
+    void Measure(Operation operation) {
+        const auto start = Clock::now();
+        operation();
+        latencies_.push_back(chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count());
+    }
+
+    // ops - число логических операций за весь замер (например, запросов в пачке ProcessQueries)
+    void Print(size_t ops = 0) {
+        if (latencies_.empty()) {
+            return;
+        }
+        sort(latencies_.begin(), latencies_.end());
+        const int64_t total_ns = accumulate(latencies_.begin(), latencies_.end(), int64_t{0});
+        if (ops == 0) {
+            ops = latencies_.size();
+        }
+        cout << left << setw(28) << name_ << right
+             << setw(10) << ops
+             << setw(12) << fixed << setprecision(1) << total_ns / 1e6
+             << setw(14) << setprecision(0) << ops / (total_ns / 1e9)
+             << setw(12) << setprecision(1) << Percentile(0.50) / 1e3
+             << setw(12) << Percentile(0.99) / 1e3
+             << setw(12) << GetPeakMemoryMb() << endl;
+    }
+
+private:
+    string name_;
+    vector<int64_t> latencies_;
+
+    double Percentile(double quantile) const {
+        const size_t index = static_cast<size_t>(quantile * (latencies_.size() - 1));
+        return static_cast<double>(latencies_[index]);
+    }
+
+    static double GetPeakMemoryMb() {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss / 1024.0;  // в Linux ru_maxrss в килобайтах
+    }
+};
+
+void PrintHeader() {
+    cout << left << setw(28) << "operation" << right
+         << setw(10) << "ops"
+         << setw(12) << "total_ms"
+         << setw(14) << "ops_per_sec"
+         << setw(12) << "p50_us"
+         << setw(12) << "p99_us"
+         << setw(12) << "peak_mb" << endl;
+}
+
+CorpusOptions ParseOptions(int argc, char* argv[]) {
+    CorpusOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const string argument = argv[i];
+        const size_t equals = argument.find('=');
+        const string name = argument.substr(0, equals);
+        istringstream value(equals == string::npos ? string() : argument.substr(equals + 1));
+        if (name == "--documents") {
+            value >> options.document_count;
+        } else if (name == "--vocabulary") {
+            value >> options.vocabulary_size;
+        } else if (name == "--document-length") {
+            value >> options.document_length;
+        } else if (name == "--queries") {
+            value >> options.query_count;
+        } else if (name == "--query-words") {
+            value >> options.query_word_count;
+        } else if (name == "--minus-ratio") {
+            value >> options.minus_word_ratio;
+        } else if (name == "--duplicate-ratio") {
+            value >> options.duplicate_ratio;
+        } else if (name == "--zipf") {
+            value >> options.zipf_exponent;
+        } else if (name == "--seed") {
+            value >> options.seed;
+        } else {
+            cerr << "Unknown option " << argument << endl;
+            exit(1);
+        }
+    }
+    return options;
+}
+
+const SimdLevel SIMD_LEVELS[] = { SimdLevel::SCALAR, SimdLevel::AVX2, SimdLevel::AVX512 };
+
+// Ядра simd_kernels.h на массивах размером с коллекцию, для каждого поддерживаемого набора инструкций
+void BenchmarkKernels(size_t size, mt19937& generator) {
+    vector<int32_t> ids(size);
+    iota(ids.begin(), ids.end(), 0);
+    shuffle(ids.begin(), ids.end(), generator);
+    vector<int64_t> values(size);
+    vector<uint8_t> flags(size);
+    for (size_t i = 0; i < size; ++i) {
+        values[i] = static_cast<int64_t>(generator() % 1000000);
+        flags[i] = generator() % 4 == 0;
+    }
+    vector<int64_t> accumulator(size);
+    vector<int32_t> out(size);
+    const int repeat_count = 100;
+    for (SimdLevel level : SIMD_LEVELS) {
+        if (level > GetSupportedSimdLevel()) {
+            continue;
+        }
+        SetSimdLevel(level);
+        const string suffix = " "s + GetSimdLevelName(level);
+        LatencyRecorder scatter_add("ScatterAdd"s + suffix);
+        LatencyRecorder collect_marked("CollectMarked"s + suffix);
+        LatencyRecorder select_at_least("SelectAtLeast"s + suffix);
+        for (int i = 0; i < repeat_count; ++i) {
+            scatter_add.Measure([&] { ScatterAdd(accumulator.data(), ids.data(), values.data(), size); });
+            collect_marked.Measure([&] { CollectMarked(flags.data(), size, out.data()); });
+            select_at_least.Measure([&] { SelectAtLeast(values.data(), size, 900000, out.data()); });
+        }
+        scatter_add.Print();
+        collect_marked.Print();
+        select_at_least.Print();
+    }
+    SetSimdLevel(GetSupportedSimdLevel());
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const CorpusOptions options = ParseOptions(argc, argv);
+    const SyntheticCorpus corpus = GenerateCorpus(options);
+    cout << "documents=" << options.document_count << " vocabulary=" << options.vocabulary_size
+         << " query_words=" << options.query_word_count << " minus_ratio=" << options.minus_word_ratio
+         << " seed=" << options.seed << endl;
+    PrintHeader();
+
+    SearchServer search_server(corpus.stop_words);
+    {
+        LatencyRecorder recorder("AddDocument");
+        for (size_t i = 0; i < corpus.documents.size(); ++i) {
+            recorder.Measure([&] {
+                search_server.AddDocument(static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+            });
+        }
+        recorder.Print();
+    }
+    {
+        LatencyRecorder recorder("FindTopDocuments seq");
+        for (const string& query : corpus.queries) {
+            recorder.Measure([&] { search_server.FindTopDocuments(execution::seq, query); });
+        }
+        recorder.Print();
+    }
+    {
+        LatencyRecorder recorder("FindTopDocuments par");
+        for (const string& query : corpus.queries) {
+            recorder.Measure([&] { search_server.FindTopDocuments(execution::par, query); });
+        }
+        recorder.Print();
+    }
+    // последовательный поиск по плотному массиву со скалярными и векторными ядрами
+    for (SimdLevel level : SIMD_LEVELS) {
+        if (level > GetSupportedSimdLevel()) {
+            continue;
+        }
+        SetSimdLevel(level);
+        LatencyRecorder recorder("FindTopDocuments seq "s + GetSimdLevelName(level));
+        for (const string& query : corpus.queries) {
+            recorder.Measure([&] { search_server.FindTopDocuments(execution::seq, query); });
+        }
+        recorder.Print();
+    }
+    SetSimdLevel(GetSupportedSimdLevel());
+    {
+        LatencyRecorder recorder("ProcessQueries");
+        recorder.Measure([&] { ProcessQueries(search_server, corpus.queries); });
+        recorder.Print(corpus.queries.size());
+    }
+
+    mt19937 generator(options.seed);
+    BenchmarkKernels(corpus.documents.size(), generator);
+    uniform_int_distribution<int> document_id(0, static_cast<int>(corpus.documents.size()) - 1);
+    {
+        LatencyRecorder recorder("MatchDocument seq");
+        for (const string& query : corpus.queries) {
+            const int id = document_id(generator);
+            recorder.Measure([&] { search_server.MatchDocument(execution::seq, query, id); });
+        }
+        recorder.Print();
+    }
+    {
+        LatencyRecorder recorder("MatchDocument par");
+        for (const string& query : corpus.queries) {
+            const int id = document_id(generator);
+            recorder.Measure([&] { search_server.MatchDocument(execution::par, query, id); });
+        }
+        recorder.Print();
+    }
+
+    vector<int> ids(search_server.begin(), search_server.end());
+    shuffle(ids.begin(), ids.end(), generator);
+    const size_t remove_count = ids.size() / 10;
+    {
+        LatencyRecorder recorder("RemoveDocument seq");
+        for (size_t i = 0; i < remove_count; ++i) {
+            recorder.Measure([&] { search_server.RemoveDocument(execution::seq, ids[i]); });
+        }
+        recorder.Print();
+    }
+    {
+        LatencyRecorder recorder("RemoveDocument par");
+        for (size_t i = remove_count; i < 2 * remove_count && i < ids.size(); ++i) {
+            recorder.Measure([&] { search_server.RemoveDocument(execution::par, ids[i]); });
+        }
+        recorder.Print();
+    }
+    {
+        // RemoveDuplicates печатает каждый найденный дубликат, на время замера глушим вывод
+        LatencyRecorder recorder("RemoveDuplicates");
+        ostringstream sink;
+        auto* const old_buffer = cout.rdbuf(sink.rdbuf());
+        recorder.Measure([&] { RemoveDuplicates(search_server); });
+        cout.rdbuf(old_buffer);
+        recorder.Print();
+    }
+    return 0;
+}
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <cstdlib>
 #include <map>
 #include <mutex>
@@ -5,7 +7,6 @@
 #include <vector>
  
 #include "log_duration.h"
-#include "test_framework.h"
  
 using namespace std::string_literals;
  
@@ -48,10 +49,10 @@ public:
         return result;
     }
     
-    void erase(const Key& key) {
+    size_t erase(const Key& key) {
         auto& bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
         std::lock_guard guard(bucket.mutex);
-        bucket.map.erase(key);
+        return bucket.map.erase(key);
     }
  
 private:
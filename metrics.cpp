@@ -0,0 +1,175 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t TIMER_COUNT = static_cast<size_t>(MetricTimer::COUNT);
+constexpr size_t COUNTER_COUNT = static_cast<size_t>(MetricCounter::COUNT);
+
+const char* const TIMER_NAMES[TIMER_COUNT] = {
+    "parse_query",
+    "find_all_documents",
+    "sort_top_k",
+    "add_document",
+};
+
+const char* const COUNTER_NAMES[COUNTER_COUNT] = {
+    "postings_scanned",
+    "candidates_accumulated",
+    "documents_filtered",
+};
+
+struct MetricsTotals {
+    array<array<uint64_t, LatencyHistogram::BUCKET_COUNT>, TIMER_COUNT> timer_counts{};
+    array<uint64_t, TIMER_COUNT> timer_sums{};
+    array<uint64_t, COUNTER_COUNT> counters{};
+
+    void Add(const ThreadMetrics& metrics) {
+        for (size_t i = 0; i < TIMER_COUNT; ++i) {
+            metrics.timers[i].MergeInto(timer_counts[i], timer_sums[i]);
+        }
+        for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+            counters[i] += metrics.counters[i].load(memory_order_relaxed);
+        }
+    }
+};
+
+// Метрики живых потоков и накопленные итоги уже завершившихся
+struct MetricsRegistry {
+    mutex guard;
+    vector<shared_ptr<ThreadMetrics>> threads;
+    MetricsTotals retired;
+};
+
+MetricsRegistry& GetRegistry() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+class ThreadMetricsHolder {
+public:
+    ThreadMetricsHolder()
+        : metrics_(make_shared<ThreadMetrics>()) {
+        auto& registry = GetRegistry();
+        lock_guard guard(registry.guard);
+        registry.threads.push_back(metrics_);
+    }
+
+    ~ThreadMetricsHolder() {
+        auto& registry = GetRegistry();
+        lock_guard guard(registry.guard);
+        registry.retired.Add(*metrics_);
+        registry.threads.erase(find(registry.threads.begin(), registry.threads.end(), metrics_));
+    }
+
+    ThreadMetrics& Get() {
+        return *metrics_;
+    }
+
+private:
+    shared_ptr<ThreadMetrics> metrics_;
+};
+
+uint64_t GetPercentile(const array<uint64_t, LatencyHistogram::BUCKET_COUNT>& counts, uint64_t total, double quantile) {
+    const uint64_t rank = static_cast<uint64_t>(quantile * (total - 1));
+    uint64_t seen = 0;
+    for (int i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i) {
+        seen += counts[i];
+        if (seen > rank) {
+            return LatencyHistogram::GetBucketLowerBound(i);
+        }
+    }
+    return LatencyHistogram::GetBucketLowerBound(LatencyHistogram::BUCKET_COUNT - 1);
+}
+
+}  // namespace
+
+int LatencyHistogram::GetBucketIndex(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<int>(value);
+    }
+    const int exponent = 63 - __builtin_clzll(value) - SUB_BUCKET_BITS;
+    const int sub_bucket = static_cast<int>((value >> exponent) & (SUB_BUCKET_COUNT - 1));
+    return min(SUB_BUCKET_COUNT * (exponent + 1) + sub_bucket, BUCKET_COUNT - 1);
+}
+
+uint64_t LatencyHistogram::GetBucketLowerBound(int index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return static_cast<uint64_t>(index);
+    }
+    const int exponent = index / SUB_BUCKET_COUNT - 1;
+    const uint64_t sub_bucket = static_cast<uint64_t>(index % SUB_BUCKET_COUNT);
+    return (SUB_BUCKET_COUNT + sub_bucket) << exponent;
+}
+
+void LatencyHistogram::MergeInto(array<uint64_t, BUCKET_COUNT>& counts, uint64_t& sum) const {
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        counts[i] += counts_[i].load(memory_order_relaxed);
+    }
+    sum += sum_.load(memory_order_relaxed);
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& count : counts_) {
+        count.store(0, memory_order_relaxed);
+    }
+    sum_.store(0, memory_order_relaxed);
+}
+
+ThreadMetrics& GetThreadMetrics() {
+    thread_local ThreadMetricsHolder holder;
+    return holder.Get();
+}
+
+string GetMetricsSnapshot() {
+    auto& registry = GetRegistry();
+    MetricsTotals totals;
+    {
+        lock_guard guard(registry.guard);
+        totals = registry.retired;
+        for (const auto& metrics : registry.threads) {
+            totals.Add(*metrics);
+        }
+    }
+
+    ostringstream out;
+    for (size_t i = 0; i < TIMER_COUNT; ++i) {
+        const auto& counts = totals.timer_counts[i];
+        const uint64_t count = accumulate(counts.begin(), counts.end(), uint64_t{0});
+        out << TIMER_NAMES[i] << " count=" << count;
+        if (count > 0) {
+            out << " mean_ns=" << totals.timer_sums[i] / count
+                << " p50_ns=" << GetPercentile(counts, count, 0.50)
+                << " p90_ns=" << GetPercentile(counts, count, 0.90)
+                << " p99_ns=" << GetPercentile(counts, count, 0.99)
+                << " max_ns=" << GetPercentile(counts, count, 1.0);
+        }
+        out << '\n';
+    }
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        out << COUNTER_NAMES[i] << ' ' << totals.counters[i] << '\n';
+    }
+    return out.str();
+}
+
+void ResetMetrics() {
+    auto& registry = GetRegistry();
+    lock_guard guard(registry.guard);
+    registry.retired = MetricsTotals{};
+    for (const auto& metrics : registry.threads) {
+        for (auto& timer : metrics->timers) {
+            timer.Reset();
+        }
+        for (auto& counter : metrics->counters) {
+            counter.store(0, memory_order_relaxed);
+        }
+    }
+}
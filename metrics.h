@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "log_duration.h"
+
+// Метрики горячих путей сервера. Каждый поток пишет в свои счётчики и гистограммы,
+// поэтому запись не требует блокировок; GetMetricsSnapshot собирает данные всех потоков.
+// Макросы METRICS_* компилируются в пустоту, если не определён SEARCH_SERVER_METRICS
+
+enum class MetricTimer {
+    PARSE_QUERY,
+    FIND_ALL_DOCUMENTS,
+    SORT_TOP_K,
+    ADD_DOCUMENT,
+    COUNT,
+};
+
+enum class MetricCounter {
+    POSTINGS_SCANNED,
+    CANDIDATES_ACCUMULATED,
+    DOCUMENTS_FILTERED,
+    COUNT,
+};
+
+// Логарифмически-линейная гистограмма в духе HDR: 16 корзин на каждую степень двойки,
+// то есть относительная погрешность значения не больше 1/16
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static constexpr int BUCKET_COUNT = SUB_BUCKET_COUNT * 48;
+
+    // Вызывается только потоком-владельцем, поэтому атомарный инкремент не нужен
+    void Record(uint64_t value) {
+        auto& bucket = counts_[GetBucketIndex(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    void MergeInto(std::array<uint64_t, BUCKET_COUNT>& counts, uint64_t& sum) const;
+    void Reset();
+
+    static int GetBucketIndex(uint64_t value);
+    static uint64_t GetBucketLowerBound(int index);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> counts_{};
+    std::atomic<uint64_t> sum_{0};
+};
+
+struct ThreadMetrics {
+    std::array<LatencyHistogram, static_cast<size_t>(MetricTimer::COUNT)> timers;
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(MetricCounter::COUNT)> counters{};
+};
+
+ThreadMetrics& GetThreadMetrics();
+
+inline void RecordMetricTimer(MetricTimer timer, uint64_t nanoseconds) {
+    GetThreadMetrics().timers[static_cast<size_t>(timer)].Record(nanoseconds);
+}
+
+inline void AddMetricCounter(MetricCounter counter, uint64_t value) {
+    auto& total = GetThreadMetrics().counters[static_cast<size_t>(counter)];
+    total.store(total.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+class ScopedMetricTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ScopedMetricTimer(MetricTimer timer)
+        : timer_(timer) {
+    }
+
+    ~ScopedMetricTimer() {
+        const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_time_);
+        RecordMetricTimer(timer_, static_cast<uint64_t>(duration.count()));
+    }
+
+private:
+    const MetricTimer timer_;
+    const Clock::time_point start_time_ = Clock::now();
+};
+
+// Текстовый снимок: для таймеров число вызовов, среднее и перцентили в наносекундах,
+// для счётчиков - суммарные значения
+std::string GetMetricsSnapshot();
+void ResetMetrics();
+
+#ifdef SEARCH_SERVER_METRICS
+#define METRICS_SCOPED_TIMER(timer) ScopedMetricTimer PROFILE_CONCAT(metricTimer, __LINE__)(timer)
+#define METRICS_ADD(counter, value) AddMetricCounter(counter, value)
+#else
+#define METRICS_SCOPED_TIMER(timer) static_cast<void>(0)
+// sizeof не вычисляет выражение, но не даёт компилятору ругаться на неиспользуемые переменные
+#define METRICS_ADD(counter, value) static_cast<void>(sizeof(value))
+#endif
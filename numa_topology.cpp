@@ -0,0 +1,71 @@
+#include "numa_topology.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+// Разбирает список вида "0-3,8-11"
+static vector<int> ParseCpuList(const string& text) {
+    vector<int> cpus;
+    istringstream in(text);
+    string range;
+    while (getline(in, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+        const size_t dash = range.find('-');
+        const int first = stoi(range.substr(0, dash));
+        const int last = dash == string::npos ? first : stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+vector<vector<int>> GetNumaNodeCpus() {
+    vector<vector<int>> nodes;
+    for (int node = 0;; ++node) {
+        ifstream in("/sys/devices/system/node/node"s + to_string(node) + "/cpulist"s);
+        if (!in) {
+            break;
+        }
+        string text;
+        getline(in, text);
+        vector<int> cpus = ParseCpuList(text);
+        if (!cpus.empty()) {
+            nodes.push_back(move(cpus));
+        }
+    }
+    if (nodes.empty()) {
+        vector<int> cpus(max(1u, thread::hardware_concurrency()));
+        for (size_t i = 0; i < cpus.size(); ++i) {
+            cpus[i] = static_cast<int>(i);
+        }
+        nodes.push_back(move(cpus));
+    }
+    return nodes;
+}
+
+bool PinCurrentThread(const vector<int>& cpus) {
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (const int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &cpu_set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <vector>
+
+// Процессоры каждого NUMA-узла (по /sys/devices/system/node). Если топологию узнать
+// не удалось, возвращается один узел со всеми процессорами
+std::vector<std::vector<int>> GetNumaNodeCpus();
+
+// Закрепляет текущий поток за указанными процессорами. Возвращает false, если
+// платформа этого не умеет или ядро отказало
+bool PinCurrentThread(const std::vector<int>& cpus);
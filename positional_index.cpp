@@ -0,0 +1,112 @@
+#include "positional_index.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+vector<uint8_t> EncodePositions(const vector<uint32_t>& positions) {
+    vector<uint8_t> encoded;
+    encoded.reserve(positions.size());
+    uint32_t previous = 0;
+    for (const uint32_t position : positions) {
+        uint32_t delta = position - previous;
+        previous = position;
+        while (delta >= 0x80) {
+            encoded.push_back(static_cast<uint8_t>(delta | 0x80));
+            delta >>= 7;
+        }
+        encoded.push_back(static_cast<uint8_t>(delta));
+    }
+    return encoded;
+}
+
+void DecodePositions(const vector<uint8_t>& encoded, vector<uint32_t>& positions) {
+    positions.clear();
+    uint32_t position = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for (const uint8_t byte : encoded) {
+        delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        position += delta;
+        positions.push_back(position);
+        delta = 0;
+        shift = 0;
+    }
+}
+
+static bool HasExactPhraseMatch(const vector<vector<uint32_t>>& positions) {
+    for (const uint32_t start : positions[0]) {
+        bool found = true;
+        for (size_t i = 1; i < positions.size() && found; ++i) {
+            found = binary_search(positions[i].begin(), positions[i].end(), start + static_cast<uint32_t>(i));
+        }
+        if (found) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Ищем минимальное окно, в котором есть все слова фразы. Повторяющееся во фразе слово
+// должно встретиться в окне столько раз, сколько во фразе: одна позиция занимает одно место
+static bool HasProximityMatch(const vector<vector<uint32_t>>& positions, int slop) {
+    // у одного и того же слова одинаковые списки позиций, а у разных слов они не пересекаются,
+    // поэтому повторы слова находятся сравнением списков
+    vector<const vector<uint32_t>*> words;
+    vector<int> required;
+    for (const vector<uint32_t>& word_positions : positions) {
+        const auto it = find_if(words.begin(), words.end(), [&](const vector<uint32_t>* word) {
+            return *word == word_positions;
+        });
+        if (it == words.end()) {
+            words.push_back(&word_positions);
+            required.push_back(1);
+        } else {
+            ++required[it - words.begin()];
+        }
+    }
+
+    vector<pair<uint32_t, size_t>> merged;
+    for (size_t i = 0; i < words.size(); ++i) {
+        for (const uint32_t position : *words[i]) {
+            merged.push_back({ position, i });
+        }
+    }
+    sort(merged.begin(), merged.end());
+
+    const size_t window = positions.size() + static_cast<size_t>(slop);
+    vector<int> counts(words.size());
+    size_t covered = 0;
+    size_t left = 0;
+    for (size_t right = 0; right < merged.size(); ++right) {
+        const size_t word = merged[right].second;
+        if (++counts[word] == required[word]) {
+            ++covered;
+        }
+        while (covered == words.size()) {
+            if (merged[right].first - merged[left].first < window) {
+                return true;
+            }
+            if (counts[merged[left].second]-- == required[merged[left].second]) {
+                --covered;
+            }
+            ++left;
+        }
+    }
+    return false;
+}
+
+bool HasPhraseMatch(const vector<vector<uint32_t>>& positions, int slop) {
+    if (positions.empty()) {
+        return true;
+    }
+    if (slop == 0) {
+        return HasExactPhraseMatch(positions);
+    }
+    return HasProximityMatch(positions, slop);
+}
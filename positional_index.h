@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Позиции слова в документе хранятся как разности соседних позиций в varint-кодировке
+std::vector<uint8_t> EncodePositions(const std::vector<uint32_t>& positions);
+void DecodePositions(const std::vector<uint8_t>& encoded, std::vector<uint32_t>& positions);
+
+// positions[i] - отсортированные позиции i-го слова фразы в документе.
+// slop == 0: слова стоят подряд в том же порядке, что и во фразе;
+// slop > 0: все слова встречаются в окне длиной positions.size() + slop в любом порядке
+bool HasPhraseMatch(const std::vector<std::vector<uint32_t>>& positions, int slop);
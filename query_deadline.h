@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+// Бюджет времени запроса. Поиск проверяет его между блоками списков документов и,
+// если время вышло или запрос отменён, возвращает то, что успел насчитать
+class QueryDeadline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit QueryDeadline(Clock::time_point deadline, const std::atomic<bool>* cancelled = nullptr)
+        : deadline_(deadline)
+        , cancelled_(cancelled) {
+    }
+
+    // Однажды истёкший дедлайн остаётся истёкшим, чтобы все потоки запроса остановились одинаково
+    bool Check() const {
+        if (expired_.load(std::memory_order_relaxed)) {
+            return true;
+        }
+        if (Clock::now() >= deadline_ || (cancelled_ && cancelled_->load(std::memory_order_relaxed))) {
+            expired_.store(true, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    bool IsExpired() const {
+        return expired_.load(std::memory_order_relaxed);
+    }
+
+private:
+    const Clock::time_point deadline_;
+    const std::atomic<bool>* const cancelled_;
+    mutable std::atomic<bool> expired_{false};
+};
@@ -0,0 +1,34 @@
+#include "query_profile.h"
+
+using namespace std;
+
+static string_view AccumulatorName(Accumulator accumulator) {
+    switch (accumulator) {
+    case Accumulator::MAP:
+        return "map"sv;
+    case Accumulator::CONCURRENT_MAP:
+        return "concurrent map"sv;
+    case Accumulator::DENSE:
+        return "dense"sv;
+    }
+    return "unknown"sv;
+}
+
+ostream& operator<<(ostream& out, const QueryProfile& profile) {
+    for (const QueryTermProfile& term : profile.terms) {
+        out << (term.is_minus ? "-"s : ""s) << term.word
+            << ": postings = "s << term.posting_count
+            << ", weight = "s << term.word_weight << endl;
+    }
+    out << "accumulator = "s << AccumulatorName(profile.accumulator) << endl
+        << "postings visited = "s << profile.postings_visited << endl
+        << "candidates after plus words = "s << profile.candidates_after_plus_words << endl
+        << "postings dropped by predicate = "s << profile.postings_dropped_by_predicate << endl
+        << "documents dropped by minus words = "s << profile.documents_dropped_by_minus_words << endl
+        << "documents dropped by phrases = "s << profile.documents_dropped_by_phrases << endl
+        << "parse = "s << profile.parse_time.count() << " ns, "s
+        << "accumulate = "s << profile.accumulate_time.count() << " ns, "s
+        << "exclude = "s << profile.exclude_time.count() << " ns, "s
+        << "sort = "s << profile.sort_time.count() << " ns"s << endl;
+    return out;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct QueryTermProfile {
+    std::string word;
+    bool is_minus = false;
+    size_t posting_count = 0;   // в скольких документах встречается слово
+    double word_weight = 0.0;   // IDF выбранной стратегии ранжирования, для минус-слов 0
+};
+
+// Чем накапливалась релевантность кандидатов
+enum class Accumulator {
+    MAP,             // std::map, последовательный поиск
+    CONCURRENT_MAP,  // ConcurrentMap, параллельный поиск
+    DENSE,           // плотный массив по id документа, последовательный поиск
+};
+
+// План выполнения запроса (EXPLAIN): что и сколько стоило на каждой фазе FindTopDocuments
+struct QueryProfile {
+    std::vector<QueryTermProfile> terms;
+    Accumulator accumulator = Accumulator::MAP;
+    size_t postings_visited = 0;  // просмотренные элементы списков; при истёкшем дедлайне меньше суммы их длин
+    size_t candidates_after_plus_words = 0;
+    size_t postings_dropped_by_predicate = 0;
+    size_t documents_dropped_by_minus_words = 0;
+    size_t documents_dropped_by_phrases = 0;
+
+    std::chrono::nanoseconds parse_time{0};
+    std::chrono::nanoseconds accumulate_time{0};
+    std::chrono::nanoseconds exclude_time{0};
+    std::chrono::nanoseconds sort_time{0};
+};
+
+std::ostream& operator<<(std::ostream& out, const QueryProfile& profile);
+
+// Добавляет время жизни объекта к фазе профиля; без профиля часы не читаются
+class ProfilePhaseTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    ProfilePhaseTimer(QueryProfile* profile, std::chrono::nanoseconds QueryProfile::* phase)
+        : profile_(profile)
+        , phase_(phase)
+        , start_time_(profile ? Clock::now() : Clock::time_point{}) {
+    }
+
+    ~ProfilePhaseTimer() {
+        if (profile_) {
+            profile_->*phase_ += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_time_);
+        }
+    }
+
+private:
+    QueryProfile* const profile_;
+    std::chrono::nanoseconds QueryProfile::* const phase_;
+    const Clock::time_point start_time_;
+};
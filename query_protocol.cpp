@@ -0,0 +1,83 @@
+#include "query_protocol.h"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+static void AppendUint32(string& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+static void AppendUint64(string& out, uint64_t value) {
+    for (int shift = 0; shift < 64; shift += 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+static uint32_t ReadUint32(const char* data) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) {
+        value = (value << 8) | static_cast<unsigned char>(data[i]);
+    }
+    return value;
+}
+
+void RequestFrameReader::Append(const char* data, size_t size) {
+    // сдвигаем непрочитанный хвост в начало, чтобы буфер не рос бесконечно
+    if (offset_ > 0 && offset_ * 2 >= buffer_.size()) {
+        buffer_.erase(0, offset_);
+        offset_ = 0;
+    }
+    buffer_.append(data, size);
+}
+
+bool RequestFrameReader::Next(QueryRequest& request) {
+    const size_t available = buffer_.size() - offset_;
+    if (available < sizeof(uint32_t)) {
+        return false;
+    }
+    const uint32_t length = ReadUint32(buffer_.data() + offset_);
+    if (length < sizeof(uint32_t) || length > MAX_REQUEST_FRAME_SIZE) {
+        throw invalid_argument("Invalid request frame length "s + to_string(length));
+    }
+    if (available < sizeof(uint32_t) + length) {
+        return false;
+    }
+    const char* frame = buffer_.data() + offset_ + sizeof(uint32_t);
+    request.request_id = ReadUint32(frame);
+    request.query.assign(frame + sizeof(uint32_t), length - sizeof(uint32_t));
+    offset_ += sizeof(uint32_t) + length;
+    return true;
+}
+
+bool RequestFrameReader::HasIncompleteFrame() const {
+    return offset_ < buffer_.size();
+}
+
+void AppendRequest(string& out, uint32_t request_id, string_view query) {
+    AppendUint32(out, static_cast<uint32_t>(sizeof(uint32_t) + query.size()));
+    AppendUint32(out, request_id);
+    out.append(query);
+}
+
+void AppendResponse(string& out, uint32_t request_id, const vector<Document>& documents) {
+    AppendUint32(out, request_id);
+    AppendUint32(out, static_cast<uint32_t>(documents.size()));
+    for (const Document& document : documents) {
+        uint64_t relevance_bits;
+        memcpy(&relevance_bits, &document.relevance, sizeof(relevance_bits));
+        AppendUint32(out, static_cast<uint32_t>(document.id));
+        AppendUint64(out, relevance_bits);
+        AppendUint32(out, static_cast<uint32_t>(document.rating));
+    }
+}
+
+void AppendErrorResponse(string& out, uint32_t request_id, string_view message) {
+    AppendUint32(out, request_id);
+    AppendUint32(out, RESPONSE_ERROR);
+    AppendUint32(out, static_cast<uint32_t>(message.size()));
+    out.append(message);
+}
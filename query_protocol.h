@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+// Бинарный протокол query_server. Все целые - little-endian.
+// Запрос:  uint32 length | uint32 request_id | query (length - 4 байта)
+// Ответ:   uint32 request_id | uint32 count | count * (int32 id | float64 relevance | int32 rating)
+// Если запрос не удалось выполнить, count == RESPONSE_ERROR, а вместо документов идёт
+// uint32 length | message
+const uint32_t RESPONSE_ERROR = UINT32_MAX;
+const uint32_t MAX_REQUEST_FRAME_SIZE = 1 << 20;
+
+struct QueryRequest {
+    uint32_t request_id = 0;
+    std::string query;
+};
+
+// Собирает запросы из потока байтов, пришедших произвольными кусками
+class RequestFrameReader {
+public:
+    void Append(const char* data, size_t size);
+
+    // Извлекает очередной полностью принятый запрос.
+    // Бросает invalid_argument, если длина кадра некорректна
+    bool Next(QueryRequest& request);
+
+    bool HasIncompleteFrame() const;
+
+private:
+    std::string buffer_;
+    size_t offset_ = 0;
+};
+
+void AppendRequest(std::string& out, uint32_t request_id, std::string_view query);
+void AppendResponse(std::string& out, uint32_t request_id, const std::vector<Document>& documents);
+void AppendErrorResponse(std::string& out, uint32_t request_id, std::string_view message);
@@ -0,0 +1,290 @@
+// Локальный сервер запросов с бинарным протоколом (query_protocol.h).
+// Собирается отдельно от main.cpp. Документы читаются из файла, по одному в строке:
+// <id> <rating> <text>
+// ./query_server --documents=docs.txt --socket=/tmp/search.sock  - Unix domain socket
+// ./query_server --documents=docs.txt < requests.bin > responses.bin - пакетный режим через stdin/stdout
+// Клиент может отправлять запросы не дожидаясь ответов: всё, что уже пришло, выполняется
+// одной пачкой параллельно, ответы на пачку уходят одной записью в порядке запросов
+#include "query_protocol.h"
+#include "search_server.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <execution>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct ServerOptions {
+    string documents_path;
+    string socket_path;  // пустой - пакетный режим
+    size_t max_batch_size = 256;
+    string stop_words = "and with"s;
+};
+
+ServerOptions ParseOptions(int argc, char* argv[]) {
+    ServerOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const string argument = argv[i];
+        const size_t equals = argument.find('=');
+        const string name = argument.substr(0, equals);
+        const string value = equals == string::npos ? string() : argument.substr(equals + 1);
+        if (name == "--documents") {
+            options.documents_path = value;
+        } else if (name == "--socket") {
+            options.socket_path = value;
+        } else if (name == "--batch") {
+            options.max_batch_size = max<size_t>(1, stoul(value));
+        } else if (name == "--stop-words") {
+            options.stop_words = value;
+        } else {
+            cerr << "Unknown option " << argument << endl;
+            exit(1);
+        }
+    }
+    if (options.documents_path.empty()) {
+        cerr << "Usage: query_server --documents=FILE [--socket=PATH] [--batch=N] [--stop-words=WORDS]" << endl;
+        exit(1);
+    }
+    return options;
+}
+
+void LoadDocuments(SearchServer& search_server, const string& path) {
+    ifstream in(path);
+    if (!in) {
+        throw invalid_argument("Cannot open "s + path);
+    }
+    string line;
+    int line_number = 0;
+    while (getline(in, line)) {
+        ++line_number;
+        if (line.empty()) {
+            continue;
+        }
+        istringstream line_in(line);
+        int document_id;
+        int rating;
+        if (!(line_in >> document_id >> rating)) {
+            throw invalid_argument("Invalid document at line "s + to_string(line_number));
+        }
+        string text;
+        getline(line_in >> ws, text);
+        search_server.AddDocument(document_id, text, DocumentStatus::ACTUAL, {rating});
+    }
+}
+
+bool WriteAll(int fd, const string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t result = write(fd, data.data() + written, data.size() - written);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += static_cast<size_t>(result);
+    }
+    return true;
+}
+
+struct QueryResult {
+    vector<Document> documents;
+    string error;
+};
+
+// Как ProcessQueries, но ошибка в одном запросе не роняет всю пачку:
+// исключение из параллельного алгоритма привело бы к std::terminate
+bool ExecuteBatch(const SearchServer& search_server, const vector<QueryRequest>& batch, int out_fd) {
+    vector<QueryResult> results(batch.size());
+    transform(execution::par, batch.begin(), batch.end(), results.begin(),
+              [&search_server](const QueryRequest& request) {
+                  QueryResult result;
+                  try {
+                      result.documents = search_server.FindTopDocuments(request.query);
+                  } catch (const exception& e) {
+                      result.error = e.what();
+                  }
+                  return result;
+              });
+    string out;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (results[i].error.empty()) {
+            AppendResponse(out, batch[i].request_id, results[i].documents);
+        } else {
+            AppendErrorResponse(out, batch[i].request_id, results[i].error);
+        }
+    }
+    return WriteAll(out_fd, out);
+}
+
+// Обслуживает одно соединение до конца входного потока или ошибки протокола
+void Serve(const SearchServer& search_server, int in_fd, int out_fd, size_t max_batch_size) {
+    RequestFrameReader reader;
+    vector<char> chunk(1 << 16);
+    vector<QueryRequest> batch;
+    bool protocol_error = false;
+    bool output_closed = false;
+    while (!protocol_error && !output_closed) {
+        const ssize_t size = read(in_fd, chunk.data(), chunk.size());
+        if (size < 0 && errno == EINTR) {
+            continue;
+        }
+        if (size <= 0) {
+            break;
+        }
+        reader.Append(chunk.data(), static_cast<size_t>(size));
+        QueryRequest request;
+        try {
+            while (!output_closed && reader.Next(request)) {
+                batch.push_back(move(request));
+                if (batch.size() == max_batch_size) {
+                    output_closed = !ExecuteBatch(search_server, batch, out_fd);
+                    batch.clear();
+                }
+            }
+        } catch (const invalid_argument& e) {
+            cerr << e.what() << endl;
+            protocol_error = true;
+        }
+        if (!batch.empty() && !output_closed) {
+            output_closed = !ExecuteBatch(search_server, batch, out_fd);
+            batch.clear();
+        }
+    }
+    if (!protocol_error && reader.HasIncompleteFrame()) {
+        cerr << "Connection closed in the middle of a request frame" << endl;
+    }
+}
+
+const auto ACCEPT_RETRY_DELAY = chrono::milliseconds(100);
+
+// Ошибки accept, после которых сокет продолжает принимать соединения
+bool IsTransientAcceptError(int error) {
+    return error == ECONNABORTED || error == EPROTO || error == EMFILE || error == ENFILE
+        || error == ENOBUFS || error == ENOMEM;
+}
+
+// Счётчик обслуживаемых соединений, которого можно дождаться
+class ActiveConnections {
+public:
+    void Add() {
+        lock_guard guard(mutex_);
+        ++count_;
+    }
+
+    // уведомление под мьютексом: дождавшийся WaitAll может сразу уничтожить объект
+    void Remove() {
+        lock_guard guard(mutex_);
+        if (--count_ == 0) {
+            all_finished_.notify_all();
+        }
+    }
+
+    void WaitAll() {
+        unique_lock lock(mutex_);
+        all_finished_.wait(lock, [this] { return count_ == 0; });
+    }
+
+private:
+    mutex mutex_;
+    condition_variable all_finished_;
+    size_t count_ = 0;
+};
+
+int ServeSocket(const SearchServer& search_server, const ServerOptions& options) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (options.socket_path.size() >= sizeof(address.sun_path)) {
+        cerr << "Socket path is too long" << endl;
+        return 1;
+    }
+    strcpy(address.sun_path, options.socket_path.c_str());
+
+    const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        cerr << "socket: " << strerror(errno) << endl;
+        return 1;
+    }
+    unlink(options.socket_path.c_str());
+    if (bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+        || listen(listen_fd, SOMAXCONN) < 0) {
+        cerr << "bind/listen: " << strerror(errno) << endl;
+        close(listen_fd);
+        return 1;
+    }
+    // клиентские потоки ссылаются на search_server и на этот счётчик, поэтому
+    // функция возвращается только после завершения всех соединений
+    ActiveConnections connections;
+    while (true) {
+        const int client_fd = accept(listen_fd, nullptr, nullptr);
+        if (client_fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            cerr << "accept: " << strerror(errno) << endl;
+            if (IsTransientAcceptError(errno)) {
+                // кончились дескрипторы или память: ждём, пока клиенты их освободят
+                this_thread::sleep_for(ACCEPT_RETRY_DELAY);
+                continue;
+            }
+            break;
+        }
+        connections.Add();
+        try {
+            thread([&search_server, &connections, client_fd, max_batch_size = options.max_batch_size] {
+                Serve(search_server, client_fd, client_fd, max_batch_size);
+                close(client_fd);
+                connections.Remove();
+            }).detach();
+        } catch (const system_error& e) {
+            cerr << "thread: " << e.what() << endl;
+            close(client_fd);
+            connections.Remove();
+        }
+    }
+    close(listen_fd);
+    connections.WaitAll();
+    return 1;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const ServerOptions options = ParseOptions(argc, argv);
+    // запись в закрытый клиентом сокет должна вернуть ошибку, а не завершить процесс
+    signal(SIGPIPE, SIG_IGN);
+
+    SearchServer search_server(options.stop_words);
+    try {
+        LoadDocuments(search_server, options.documents_path);
+    } catch (const invalid_argument& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    cerr << "Loaded " << search_server.GetDocumentCount() << " documents" << endl;
+
+    if (options.socket_path.empty()) {
+        Serve(search_server, STDIN_FILENO, STDOUT_FILENO, options.max_batch_size);
+        return 0;
+    }
+    return ServeSocket(search_server, options);
+}
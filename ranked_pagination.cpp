@@ -0,0 +1,70 @@
+#include "ranked_pagination.h"
+
+#include <algorithm>
+#include <optional>
+
+using namespace std;
+
+RankedPaginationCache::RankedPaginationCache(const SearchServer& search_server, size_t page_size,
+                                             Clock::duration ttl, size_t max_queries)
+    : search_server_(search_server)
+    , page_size_(page_size)
+    , ttl_(ttl)
+    , max_queries_(max_queries) {
+    if (page_size_ == 0 || max_queries_ == 0) {
+        throw invalid_argument("Page size and cache capacity must be positive"s);
+    }
+}
+
+vector<Document> RankedPaginationCache::GetPage(string_view raw_query, size_t page, DocumentStatus status) {
+    const auto now = Clock::now();
+    RemoveExpired(now);
+
+    Key key{string(raw_query), status};
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        while (entries_.size() >= max_queries_) {
+            entries_.erase(expiration_queue_.front().second);
+            expiration_queue_.pop_front();
+        }
+        it = entries_.emplace(key, Entry{{}, false, now + ttl_}).first;
+        expiration_queue_.emplace_back(it->second.expires_at, key);
+    }
+
+    Entry& entry = it->second;
+    const size_t first = page * page_size_;
+    const size_t last = first + page_size_;
+    if (entry.documents.size() < last && !entry.exhausted) {
+        Extend(key, entry, last);
+    }
+    if (first >= entry.documents.size()) {
+        return {};
+    }
+    return {entry.documents.begin() + first, entry.documents.begin() + min(last, entry.documents.size())};
+}
+
+size_t RankedPaginationCache::GetCachedQueryCount() const {
+    return entries_.size();
+}
+
+void RankedPaginationCache::RemoveExpired(Clock::time_point now) {
+    while (!expiration_queue_.empty() && expiration_queue_.front().first <= now) {
+        entries_.erase(expiration_queue_.front().second);
+        expiration_queue_.pop_front();
+    }
+}
+
+void RankedPaginationCache::Extend(const Key& key, Entry& entry, size_t required_count) const {
+    const size_t count = required_count - entry.documents.size() + (PREFETCH_PAGES - 1) * page_size_;
+    optional<Document> after;
+    if (!entry.documents.empty()) {
+        after = entry.documents.back();
+    }
+    const DocumentStatus status = key.second;
+    const vector<Document> documents = search_server_.FindTopDocumentsAfter(key.first,
+        [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        }, after, count);
+    entry.documents.insert(entry.documents.end(), documents.begin(), documents.end());
+    entry.exhausted = documents.size() < count;
+}
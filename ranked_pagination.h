@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Кэш ранжированной выдачи для последовательного листания страниц одного запроса.
+// Найденные документы запоминаются вместе с курсором, следующие страницы дочитываются
+// через FindTopDocumentsAfter, а не пересчётом всего запроса с нуля.
+// Записи живут ttl с момента создания: изменения сервера за это время в кэш не попадают
+class RankedPaginationCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit RankedPaginationCache(const SearchServer& search_server,
+                                   size_t page_size = MAX_RESULT_DOCUMENT_COUNT,
+                                   Clock::duration ttl = std::chrono::seconds(30),
+                                   size_t max_queries = 1024);
+
+    // page - номер страницы с нуля
+    std::vector<Document> GetPage(std::string_view raw_query, size_t page, DocumentStatus status = DocumentStatus::ACTUAL);
+
+    size_t GetCachedQueryCount() const;
+
+private:
+    using Key = std::pair<std::string, DocumentStatus>;
+
+    struct Entry {
+        std::vector<Document> documents;
+        bool exhausted = false;
+        Clock::time_point expires_at;
+    };
+
+    // при дочитывании берём сразу несколько страниц вперёд
+    static const size_t PREFETCH_PAGES = 4;
+
+    const SearchServer& search_server_;
+    size_t page_size_;
+    Clock::duration ttl_;
+    size_t max_queries_;
+    std::map<Key, Entry> entries_;
+    // очередь создания записей для вытеснения устаревших и самых старых
+    std::deque<std::pair<Clock::time_point, Key>> expiration_queue_;
+
+    void RemoveExpired(Clock::time_point now);
+    void Extend(const Key& key, Entry& entry, size_t required_count) const;
+};
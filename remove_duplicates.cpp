@@ -9,6 +9,17 @@ using namespace std;
 */
 
 void RemoveDuplicates(SearchServer& search_server) {
+    if (search_server.GetDuplicateMode() != DuplicateMode::IGNORE) {
+        // дубликаты уже найдены при добавлении, полный проход не нужен
+        const vector<int> duplicates(search_server.GetDuplicateDocumentIds().begin(),
+                                     search_server.GetDuplicateDocumentIds().end());
+        for (const int document_id : duplicates) {
+            cout << "Found duplicate document id " << document_id << endl;
+            search_server.RemoveDocument(document_id);
+        }
+        return;
+    }
+
     vector<int> ids(search_server.begin(), search_server.end()); // решил так
 
     set<set<string>> m;
@@ -16,7 +27,7 @@ void RemoveDuplicates(SearchServer& search_server) {
         set<string> test;
         auto word_freq = search_server.GetWordFrequencies(document_id);
         for (auto& [word, freq] : word_freq) {
-            test.insert(word);
+            test.insert(string(word));
         }
 
         if (!m.count(test)) {
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+// Стратегии ранжирования передаются в FindTopDocuments параметром шаблона:
+// методы статические, поэтому компилятор встраивает их прямо в цикл по спискам документов.
+// term_freq - доля слова в документе (как в индексе), document_length - число слов без стоп-слов
+
+// Классический TF-IDF, используется по умолчанию
+struct TfIdfScorer {
+    static double ComputeWordWeight(int document_count, size_t word_document_count) {
+        return std::log(document_count * 1.0 / word_document_count);
+    }
+
+    static double ComputeRelevance(double term_freq, double word_weight, int /*document_length*/,
+                                   double /*average_document_length*/) {
+        return term_freq * word_weight;
+    }
+};
+
+// Okapi BM25 с насыщением частоты слова и нормировкой на длину документа
+struct Bm25Scorer {
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+
+    static double ComputeWordWeight(int document_count, size_t word_document_count) {
+        const double word_count = static_cast<double>(word_document_count);
+        return std::log((document_count - word_count + 0.5) / (word_count + 0.5) + 1.0);
+    }
+
+    static double ComputeRelevance(double term_freq, double word_weight, int document_length,
+                                   double average_document_length) {
+        const double occurrences = term_freq * document_length;
+        const double length_norm = K1 * (1.0 - B + B * document_length / average_document_length);
+        return word_weight * occurrences * (K1 + 1.0) / (occurrences + length_norm);
+    }
+};
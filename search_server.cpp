@@ -1,15 +1,31 @@
 #include "search_server.h"
 #include <memory>
 #include <list>
+#include <charconv>
+#include <limits>
 using namespace std;
 
 void SearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    METRICS_SCOPED_TIMER(MetricTimer::ADD_DOCUMENT);
     if ((document_id < 0) || (documents_.count(document_id) > 0)) {
         throw invalid_argument("Invalid document_id"s);
     }
+    if (duplicate_mode_ == DuplicateMode::REJECT) {
+        auto words = SplitIntoWordsNoStop(document);
+        sort(words.begin(), words.end());
+        words.erase(unique(words.begin(), words.end()), words.end());
+        if (const auto original_id = FindDuplicateOf(words, ComputeFingerprint(words))) {
+            throw invalid_argument("Document is a duplicate of document "s + to_string(*original_id));
+        }
+    }
     documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status, std::string(document)});
     
-    const auto words = SplitIntoWordsNoStop(documents_.at(document_id).text);
+    auto words = SplitIntoWordsNoStop(documents_.at(document_id).text);
+    for (string_view& word : words) {
+        word = InternWord(word);
+    }
+    documents_.at(document_id).word_count = static_cast<int>(words.size());
+    total_word_count_ += words.size();
     const double inv_word_count = 1.0 / words.size();
     if (!words.empty()) {
         for (string_view word : words) {
@@ -19,15 +35,24 @@ void SearchServer::AddDocument(int document_id, string_view document, DocumentSt
     } else {
         word_frequencies_[document_id] = {};
     }
+    if (positional_index_enabled_) {
+        IndexPositions(document_id, words);
+    }
     
     document_ids_.insert(document_id);
-        
+    if (duplicate_mode_ != DuplicateMode::IGNORE) {
+        IndexFingerprint(document_id);
+    }
 }
 
 void SearchServer::RemoveDocument(int document_id) {
     if (document_ids_.count(document_id) == 0) {
         return;
     }
+    if (duplicate_mode_ != DuplicateMode::IGNORE) {
+        RemoveFingerprint(document_id);
+    }
+    total_word_count_ -= documents_.at(document_id).word_count;
     documents_.erase(document_id);
     document_ids_.erase(document_id);
 
@@ -35,6 +60,9 @@ void SearchServer::RemoveDocument(int document_id) {
         if (word_to_document_freqs_.count(word)) {
             word_to_document_freqs_[word].erase(document_id);
         }
+        if (positional_index_enabled_) {
+            word_to_document_positions_.at(word).erase(document_id);
+        }
     }
     
     word_frequencies_.erase(document_id);
@@ -49,6 +77,10 @@ void SearchServer::RemoveDocument(execution::parallel_policy policy, int documen
     if(!document_ids_.count(document_id)) {
         return;
     }
+    if (duplicate_mode_ != DuplicateMode::IGNORE) {
+        RemoveFingerprint(document_id);
+    }
+    total_word_count_ -= documents_.at(document_id).word_count;
     documents_.erase(document_id);
     document_ids_.erase(document_id);
     
@@ -67,6 +99,9 @@ void SearchServer::RemoveDocument(execution::parallel_policy policy, int documen
         v.end(),
         [&](const pair<const string_view, double>* temp) {
             word_to_document_freqs_[temp->first].erase(document_id);
+            if (positional_index_enabled_) {
+                word_to_document_positions_.at(temp->first).erase(document_id);
+            }
         }
     );
     word_frequencies_.erase(document_id);
@@ -85,6 +120,41 @@ const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id
     return empty;
 }
 
+void SearchServer::SetDuplicateMode(DuplicateMode mode) {
+    duplicate_mode_ = mode;
+    fingerprint_to_document_ids_.clear();
+    duplicate_document_ids_.clear();
+    if (mode == DuplicateMode::IGNORE) {
+        return;
+    }
+    for (const int document_id : document_ids_) {
+        IndexFingerprint(document_id);
+    }
+}
+
+DuplicateMode SearchServer::GetDuplicateMode() const {
+    return duplicate_mode_;
+}
+
+const set<int>& SearchServer::GetDuplicateDocumentIds() const {
+    return duplicate_document_ids_;
+}
+
+void SearchServer::SetPositionalIndex(bool enabled) {
+    positional_index_enabled_ = enabled;
+    word_to_document_positions_.clear();
+    if (!enabled) {
+        return;
+    }
+    for (const int document_id : document_ids_) {
+        auto words = SplitIntoWordsNoStop(documents_.at(document_id).text);
+        for (string_view& word : words) {
+            word = InternWord(word);
+        }
+        IndexPositions(document_id, words);
+    }
+}
+
 vector<Document> SearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
     return FindTopDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
         return document_status == status;
@@ -96,29 +166,61 @@ vector<Document> SearchServer::FindTopDocuments(string_view raw_query) const {
 }
 
 tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(string_view raw_query, int document_id) const {
-    const auto query = ParseQuery(raw_query);
-
-    vector<string_view> matched_words;
+    MatchBuffer buffer;
+    const DocumentStatus status = MatchDocument(raw_query, document_id, buffer);
+    return { move(buffer.matched_words_), status };
+}
 
-    for (string_view word : query.plus_words) {
-        
-        if (word_frequencies_.at(document_id).count(word) == 0) {
-            continue;
+DocumentStatus SearchServer::MatchDocument(string_view raw_query, int document_id, MatchBuffer& buffer) const {
+    ParseQuery(raw_query, buffer.query_words_, buffer.query_);
+    CheckPhrasesSupported(buffer.query_);
+    auto& plus_words = buffer.query_.plus_words;
+    plus_words.erase(unique(plus_words.begin(), plus_words.end()), plus_words.end());
+
+    const auto& word_freqs = word_frequencies_.at(document_id);
+    const DocumentStatus status = documents_.at(document_id).status;
+    buffer.matched_words_.clear();
+    for (string_view word : buffer.query_.minus_words) {
+        if (word_freqs.count(word)) {
+            return status;
         }
-        
-        if(word_frequencies_.at(document_id).count(word)) {
-            matched_words.push_back(word);
+    }
+    if (!MatchesPhrases(document_id, buffer.query_.phrases)) {
+        return status;
+    }
+    for (string_view word : plus_words) {
+        if (word_freqs.count(word)) {
+            buffer.matched_words_.push_back(word);
         }
     }
-    for (string_view word : query.minus_words) {
-        if(word_frequencies_.at(document_id).count(word) == 0) {
-            continue;
+    return status;
+}
+
+uint64_t SearchServer::MatchDocumentMask(string_view raw_query, int document_id, MatchBuffer& buffer) const {
+    ParseQuery(raw_query, buffer.query_words_, buffer.query_);
+    CheckPhrasesSupported(buffer.query_);
+    auto& plus_words = buffer.query_.plus_words;
+    plus_words.erase(unique(plus_words.begin(), plus_words.end()), plus_words.end());
+    if (plus_words.size() > 64) {
+        throw invalid_argument("Query has too many words for a match mask"s);
+    }
+
+    const auto& word_freqs = word_frequencies_.at(document_id);
+    for (string_view word : buffer.query_.minus_words) {
+        if (word_freqs.count(word)) {
+            return 0;
         }
-        if (word_frequencies_.at(document_id).count(word)) {
-            matched_words.clear();
+    }
+    if (!MatchesPhrases(document_id, buffer.query_.phrases)) {
+        return 0;
+    }
+    uint64_t mask = 0;
+    for (size_t i = 0; i < plus_words.size(); ++i) {
+        if (word_freqs.count(plus_words[i])) {
+            mask |= uint64_t{1} << i;
         }
     }
-    return { matched_words, documents_.at(document_id).status };
+    return mask;
 }
 
 tuple<vector<string_view>, DocumentStatus> 
@@ -127,7 +229,8 @@ SearchServer::MatchDocument(execution::sequenced_policy policy, string_view raw_
 }
 
 tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(execution::parallel_policy policy, string_view raw_query, int document_id) const {
-    const auto query = ParseQuery(raw_query);
+    auto query = ParseQuery(raw_query);
+    CheckPhrasesSupported(query);
     const map<string_view, double>& tmp = word_frequencies_.at(document_id);
     
     bool flag = any_of(
@@ -136,15 +239,15 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(execution
         query.minus_words.end(),
         [&](string_view view) {return tmp.count(view);}
     );
-    if (flag) {
-        return { {}, documents_.at(document_id).status};
-    }
-    
-    if(query.plus_words.empty()) {
-        return { {}, documents_.at(document_id).status};
+    if (flag || !MatchesPhrases(document_id, query.phrases)) {
+        return { vector<string_view>{}, documents_.at(document_id).status};
     }
     
+    // плюс-слова уже отсортированы в ParseQuery, поэтому найденные слова
+    // остаются упорядоченными и досортировывать их не нужно
+    query.plus_words.erase(unique(query.plus_words.begin(), query.plus_words.end()), query.plus_words.end());
     vector<string_view> matched_words;
+    matched_words.reserve(query.plus_words.size());
     
     copy_if(
         query.plus_words.begin(),
@@ -152,13 +255,15 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(execution
         back_inserter(matched_words),
         [&](string_view view) {return tmp.count(view);}
     );
-    sort( matched_words.begin(), matched_words.end() );
-    matched_words.erase( unique( matched_words.begin(), matched_words.end() ), matched_words.end() );
     
     return { matched_words, documents_.at(document_id).status};
     
 }
 
+vector<match_type> SearchServer::MatchDocuments(string_view raw_query, const vector<int>& document_ids) const {
+    return MatchDocuments(execution::seq, raw_query, document_ids);
+}
+
 bool SearchServer::IsStopWord(string_view word) const {
     return stop_words_.count(word) > 0;
 }
@@ -183,6 +288,14 @@ vector<string_view> SearchServer::SplitIntoWordsNoStop(string_view text) const {
     return words;
 }
 
+string_view SearchServer::InternWord(string_view word) {
+    auto it = vocabulary_.find(word);
+    if (it == vocabulary_.end()) {
+        it = vocabulary_.emplace(word).first;
+    }
+    return *it;
+}
+
 int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
     if (ratings.empty()) {
         return 0;
@@ -191,6 +304,72 @@ int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
     return accumulate(ratings.begin(), ratings.end(), 0) / static_cast<int>(ratings.size());
 }
 
+// words должны быть отсортированы и не содержать повторов
+size_t SearchServer::ComputeFingerprint(const vector<string_view>& words) {
+    const hash<string_view> hasher;
+    size_t fingerprint = words.size();
+    for (string_view word : words) {
+        fingerprint ^= hasher(word) + 0x9e3779b97f4a7c15ULL + (fingerprint << 6) + (fingerprint >> 2);
+    }
+    return fingerprint;
+}
+
+vector<string_view> SearchServer::GetDocumentWords(int document_id) const {
+    const auto& word_freqs = word_frequencies_.at(document_id);
+    vector<string_view> words;
+    words.reserve(word_freqs.size());
+    for (const auto& [word, _] : word_freqs) {
+        words.push_back(word);
+    }
+    return words;
+}
+
+optional<int> SearchServer::FindDuplicateOf(const vector<string_view>& words, size_t fingerprint) const {
+    const auto it = fingerprint_to_document_ids_.find(fingerprint);
+    if (it == fingerprint_to_document_ids_.end()) {
+        return nullopt;
+    }
+    // в корзине могут оказаться и коллизии хеша, поэтому сравниваем сами наборы слов.
+    // Оригиналом считается копия с наименьшим id
+    optional<int> original_id;
+    for (const int document_id : it->second) {
+        const auto& word_freqs = word_frequencies_.at(document_id);
+        if ((!original_id || document_id < *original_id)
+            && equal(words.begin(), words.end(), word_freqs.begin(), word_freqs.end(),
+                     [](string_view word, const auto& word_freq) { return word == word_freq.first; })) {
+            original_id = document_id;
+        }
+    }
+    return original_id;
+}
+
+void SearchServer::IndexFingerprint(int document_id) {
+    const auto words = GetDocumentWords(document_id);
+    const size_t fingerprint = ComputeFingerprint(words);
+    if (const auto original_id = FindDuplicateOf(words, fingerprint)) {
+        // документ с меньшим id становится оригиналом, прежний оригинал - дубликатом
+        duplicate_document_ids_.insert(max(document_id, *original_id));
+    }
+    fingerprint_to_document_ids_[fingerprint].push_back(document_id);
+}
+
+void SearchServer::RemoveFingerprint(int document_id) {
+    const auto words = GetDocumentWords(document_id);
+    const size_t fingerprint = ComputeFingerprint(words);
+    auto& bucket = fingerprint_to_document_ids_.at(fingerprint);
+    bucket.erase(find(bucket.begin(), bucket.end(), document_id));
+    if (duplicate_document_ids_.erase(document_id) == 0) {
+        // удаляется оригинал: его место занимает оставшаяся копия с наименьшим id
+        const auto original_id = FindDuplicateOf(words, fingerprint);
+        if (original_id) {
+            duplicate_document_ids_.erase(*original_id);
+        }
+    }
+    if (bucket.empty()) {
+        fingerprint_to_document_ids_.erase(fingerprint);
+    }
+}
+
 SearchServer::QueryWord SearchServer::ParseQueryWord(string_view text) const {
     if (text.empty()) {
         throw invalid_argument("Query word is empty"s);
@@ -208,28 +387,260 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(string_view text) const {
     return { word, is_minus, IsStopWord(word) };
 }
 
-SearchServer::Query SearchServer::ParseQuery(string_view text) const {
+SearchServer::Query SearchServer::ParseQuery(string_view text, const WildcardExpansions* expansions) const {
     Query result;
-    for (string_view word : SplitIntoWords(text)) {
-        const auto query_word = ParseQueryWord(word);
+    vector<string_view> words;
+    ParseQuery(text, words, result, expansions);
+    return result;
+}
+
+void SearchServer::ParseQuery(string_view text, vector<string_view>& words, Query& result, const WildcardExpansions* expansions) const {
+    METRICS_SCOPED_TIMER(MetricTimer::PARSE_QUERY);
+    result.plus_words.clear();
+    result.minus_words.clear();
+    result.phrases.clear();
+    result.wildcards.clear();
+    SplitIntoWords(text, words);
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (words[i][0] == '"') {
+            i = ParsePhrase(words, i, result);
+            continue;
+        }
+        const auto query_word = ParseQueryWord(words[i]);
         if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
+            auto& terms = query_word.is_minus ? result.minus_words : result.plus_words;
+            if (IsWildcard(query_word.data) && query_word.is_minus) {
+                // исключение должно быть полным, поэтому минус-шаблон раскрывается без ограничения
+                ExpandWildcard(query_word.data, terms, numeric_limits<size_t>::max());
+            }
+            else if (IsWildcard(query_word.data)) {
+                result.wildcards.push_back(query_word.data);
+                AddWildcardTerms(query_word.data, expansions, terms);
             }
             else {
-                result.plus_words.push_back(query_word.data);
+                terms.push_back(ResolveEscapes(query_word.data));
             }
         }
     }
     sort(result.plus_words.begin(), result.plus_words.end());
     sort(result.minus_words.begin(), result.minus_words.end());
-    return result;
 }
 
 
-double SearchServer::ComputeWordInverseDocumentFreq(string_view word) const {
+bool SearchServer::IsWildcard(string_view word) {
+    return FindWildcard(word) != word.npos;
+}
+
+string_view SearchServer::ResolveEscapes(string_view word) const {
+    if (word.find("\\*"sv) == word.npos) {
+        return word;
+    }
+    // как и остальные слова запроса, слово должно указывать на строку словаря, а не на временную
+    const auto it = vocabulary_.find(UnescapeWildcard(word));
+    return it == vocabulary_.end() ? word : string_view(*it);
+}
+
+void SearchServer::ExpandWildcard(string_view pattern, vector<string_view>& terms, size_t limit) const {
+    // слова с общим префиксом идут в словаре подряд, поэтому просматривается только их диапазон
+    const size_t wildcard = FindWildcard(pattern);
+    if (wildcard == 0) {
+        throw invalid_argument("Wildcard "s + std::string(pattern) + " must not start with *"s);
+    }
+    const string prefix = UnescapeWildcard(pattern.substr(0, wildcard));
+    size_t expanded = 0;
+    for (auto it = word_to_document_freqs_.lower_bound(prefix);
+         it != word_to_document_freqs_.end() && it->first.substr(0, prefix.size()) == prefix && expanded < limit;
+         ++it) {
+        if (!it->second.empty() && MatchesWildcard(pattern, it->first)) {
+            terms.push_back(it->first);
+            ++expanded;
+        }
+    }
+}
+
+void SearchServer::AddWildcardTerms(string_view pattern, const WildcardExpansions* expansions, vector<string_view>& terms) const {
+    if (expansions) {
+        if (const auto it = expansions->find(pattern); it != expansions->end()) {
+            terms.insert(terms.end(), it->second.begin(), it->second.end());
+            return;
+        }
+    }
+    ExpandWildcard(pattern, terms, MAX_WILDCARD_EXPANSION);
+}
+
+FrontCodedDictionary SearchServer::BuildTermDictionary() const {
+    vector<string_view> terms;
+    vector<uint32_t> document_counts;
+    for (const auto& [word, postings] : word_to_document_freqs_) {
+        if (!postings.empty()) {
+            terms.push_back(word);
+            document_counts.push_back(static_cast<uint32_t>(postings.size()));
+        }
+    }
+    return FrontCodedDictionary(terms, document_counts);
+}
+
+// Разбирает фразу, начинающуюся с words[first], и возвращает индекс её последнего слова
+size_t SearchServer::ParsePhrase(const vector<string_view>& words, size_t first, Query& result) const {
+    Phrase phrase;
+    for (size_t i = first; i < words.size(); ++i) {
+        string_view word = words[i];
+        if (i == first) {
+            word.remove_prefix(1);
+        }
+        const size_t quote = word.find('"');
+        string_view tail;
+        if (quote != word.npos) {
+            tail = word.substr(quote + 1);
+            word = word.substr(0, quote);
+        }
+        if (!word.empty()) {
+            const auto query_word = ParseQueryWord(word);
+            if (query_word.is_minus) {
+                throw invalid_argument("Phrase must not contain minus word "s + std::string(word));
+            }
+            if (IsWildcard(query_word.data)) {
+                throw invalid_argument("Phrase must not contain wildcard "s + std::string(word));
+            }
+            if (!query_word.is_stop) {
+                const string_view phrase_word = ResolveEscapes(query_word.data);
+                phrase.words.push_back(phrase_word);
+                result.plus_words.push_back(phrase_word);
+            }
+        }
+        if (quote == word.npos) {
+            continue;
+        }
+        if (!tail.empty()) {
+            const auto [end, error] = from_chars(tail.data() + 1, tail.data() + tail.size(), phrase.slop);
+            if (tail[0] != '~' || tail.size() == 1 || error != errc{} || end != tail.data() + tail.size() || phrase.slop < 0) {
+                throw invalid_argument("Invalid phrase proximity "s + std::string(tail));
+            }
+        }
+        if (!phrase.words.empty()) {
+            result.phrases.push_back(move(phrase));
+        }
+        return i;
+    }
+    throw invalid_argument("Phrase is not closed in query "s + std::string(words[first]));
+}
+
+void SearchServer::CheckPhrasesSupported(const Query& query) const {
+    if (!query.phrases.empty() && !positional_index_enabled_) {
+        throw invalid_argument("Phrase queries require the positional index"s);
+    }
+}
+
+bool SearchServer::MatchesPhrases(int document_id, const vector<Phrase>& phrases) const {
+    vector<vector<uint32_t>> positions;
+    for (const Phrase& phrase : phrases) {
+        positions.resize(phrase.words.size());
+        for (size_t i = 0; i < phrase.words.size(); ++i) {
+            const auto word_it = word_to_document_positions_.find(phrase.words[i]);
+            if (word_it == word_to_document_positions_.end()) {
+                return false;
+            }
+            const auto document_it = word_it->second.find(document_id);
+            if (document_it == word_it->second.end()) {
+                return false;
+            }
+            DecodePositions(document_it->second, positions[i]);
+        }
+        if (!HasPhraseMatch(positions, phrase.slop)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SearchServer::UseDenseAccumulator(const Query& query, const SearchContext& context) const {
+    // фразам нужен полный набор кандидатов
+    if (!query.phrases.empty() || document_ids_.empty()) {
+        return false;
+    }
+    const size_t id_range = static_cast<size_t>(*document_ids_.rbegin()) + 1;
+    if (id_range > DENSE_ID_RANGE_FACTOR * document_ids_.size()) {
+        return false;
+    }
+    size_t posting_count = 0;
+    for (string_view word : query.plus_words) {
+        const auto postings = word_to_document_freqs_.find(word);
+        if (postings != word_to_document_freqs_.end()) {
+            posting_count += postings->second.size();
+        }
+    }
+    return posting_count * DENSE_MIN_FILL_RATIO >= id_range;
+}
 
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+size_t SearchServer::FilterByPhrases(map<int, int64_t>& document_to_relevance, const Query& query) const {
+    CheckPhrasesSupported(query);
+    if (query.phrases.empty()) {
+        return 0;
+    }
+    size_t dropped = 0;
+    for (auto it = document_to_relevance.begin(); it != document_to_relevance.end();) {
+        if (MatchesPhrases(it->first, query.phrases)) {
+            ++it;
+        } else {
+            it = document_to_relevance.erase(it);
+            ++dropped;
+        }
+    }
+    METRICS_ADD(MetricCounter::DOCUMENTS_FILTERED, dropped);
+    return dropped;
+}
+
+void SearchServer::IndexPositions(int document_id, const vector<string_view>& words) {
+    map<string_view, vector<uint32_t>> word_positions;
+    for (size_t i = 0; i < words.size(); ++i) {
+        word_positions[words[i]].push_back(static_cast<uint32_t>(i));
+    }
+    for (const auto& [word, positions] : word_positions) {
+        word_to_document_positions_[word][document_id] = EncodePositions(positions);
+    }
+}
+
+double SearchServer::ComputeAverageDocumentLength() const {
+    if (documents_.empty()) {
+        return 0.0;
+    }
+    return total_word_count_ * 1.0 / documents_.size();
+}
+
+SearchServer::CollectionStatistics SearchServer::GetQueryStatistics(string_view raw_query, const WildcardExpansions* expansions) const {
+    const Query query = ParseQuery(raw_query, expansions);
+    CheckPhrasesSupported(query);
+    CollectionStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    statistics.total_word_count = total_word_count_;
+    statistics.average_document_length = ComputeAverageDocumentLength();
+    vector<string_view> terms;
+    for (string_view pattern : query.wildcards) {
+        terms.clear();
+        AddWildcardTerms(pattern, expansions, terms);
+        statistics.wildcard_expansions.emplace(pattern, vector<string>(terms.begin(), terms.end()));
+    }
+    for (string_view word : query.plus_words) {
+        const auto postings = word_to_document_freqs_.find(word);
+        statistics.word_document_counts.emplace(word, postings == word_to_document_freqs_.end() ? 0 : postings->second.size());
+    }
+    return statistics;
+}
+
+int SearchServer::GetDocumentCount(const SearchContext& context) const {
+    return context.statistics ? context.statistics->document_count : GetDocumentCount();
+}
+
+double SearchServer::ComputeAverageDocumentLength(const SearchContext& context) const {
+    return context.statistics ? context.statistics->average_document_length : ComputeAverageDocumentLength();
+}
+
+size_t SearchServer::GetWordDocumentCount(string_view word, size_t posting_count, const SearchContext& context) const {
+    if (!context.statistics) {
+        return posting_count;
+    }
+    const auto it = context.statistics->word_document_counts.find(word);
+    return it == context.statistics->word_document_counts.end() ? posting_count : it->second;
 }
 
 void AddDocument(SearchServer& search_server, int document_id, string_view document, DocumentStatus status,
@@ -255,21 +666,23 @@ void FindTopDocuments(const SearchServer& search_server, string_view raw_query)
     }
 }
 
-set<int>::const_iterator SearchServer::begin() {
+set<int>::const_iterator SearchServer::begin() const {
     return document_ids_.begin();
 }
 
-set<int>::const_iterator SearchServer::end() {
+set<int>::const_iterator SearchServer::end() const {
     return document_ids_.end();
 }
 
-void MatchDocuments(SearchServer& search_server, string_view query) {
+void MatchDocuments(const SearchServer& search_server, string_view query) {
     LOG_DURATION_STREAM("Operation time", cout);
     try {
         cout << "Матчинг документов по запросу: " << query << endl;
-        for (auto document_id : search_server) {
-            const auto [words, status] = search_server.MatchDocument(query, document_id);
-            PrintMatchDocumentResult(document_id, words, status);
+        const vector<int> document_ids(search_server.begin(), search_server.end());
+        const auto matches = search_server.MatchDocuments(query, document_ids);
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            const auto& [words, status] = matches[i];
+            PrintMatchDocumentResult(document_ids[i], words, status);
         }
     }
     catch (const invalid_argument& e) {
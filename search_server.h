@@ -9,18 +9,62 @@
 #include <numeric>
 #include <stdexcept>
 #include <execution>
+#include <atomic>
 #include <deque>
 #include <cmath>
+#include <cstdint>
 #include <future>
+#include <optional>
+#include <unordered_map>
 #include "string_processing.h"
 #include "document.h"
 #include "read_input_functions.h"
 #include "log_duration.h"
 #include "concurrent_map.h"
-
-const double MAX_DIFFERENCE = 1e-6;
+#include "positional_index.h"
+#include "scoring.h"
+#include "metrics.h"
+#include "query_profile.h"
+#include "query_deadline.h"
+#include "simd_kernels.h"
+#include "term_dictionary.h"
+
+// Релевантность накапливается в целых долях MAX_DIFFERENCE. Целочисленная сумма не зависит
+// от порядка слагаемых, поэтому последовательная и параллельная версии поиска дают одинаковый результат
+const int64_t RELEVANCE_SCALE = 1'000'000;
+const double MAX_DIFFERENCE = 1.0 / RELEVANCE_SCALE;
 using match_type = std::tuple<std::vector<std::string_view>, DocumentStatus>;
 
+inline int64_t QuantizeRelevance(double relevance) {
+    return std::llround(relevance * RELEVANCE_SCALE);
+}
+
+inline double DequantizeRelevance(int64_t quantized_relevance) {
+    return static_cast<double>(quantized_relevance) / RELEVANCE_SCALE;
+}
+
+// Порядок выдачи: по убыванию релевантности, при равной релевантности - по убыванию рейтинга,
+// затем по возрастанию id. Релевантность найденных документов кратна MAX_DIFFERENCE, поэтому
+// точное сравнение совпадает со сравнением целых значений. Порядок полный, документ может служить курсором страницы
+inline bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (lhs.relevance != rhs.relevance) {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+// Что делать с документом, набор слов которого совпадает с уже добавленным.
+// Ищутся только точные совпадения наборов слов, почти совпадающие документы дубликатами не считаются
+enum class DuplicateMode {
+    IGNORE,  // не отслеживать дубликаты
+    REPORT,  // добавлять документ, но запоминать в GetDuplicateDocumentIds() id всех копий,
+             // кроме копии с наименьшим id, как и полный проход RemoveDuplicates
+    REJECT,  // бросать invalid_argument из AddDocument
+};
+
 class SearchServer {
 public:
     
@@ -50,48 +94,136 @@ public:
     void RemoveDocument(std::execution::sequenced_policy policy, int document_id);
 
     
-    template <typename DocumentPredicate>
+    // Scorer - стратегия ранжирования из scoring.h, например
+    // FindTopDocuments<Bm25Scorer>(std::execution::par, raw_query)
+    template <typename Scorer = TfIdfScorer, typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
-    template <typename ExecutionPolicy, typename DocumentPredicate>
+    template <typename Scorer = TfIdfScorer, typename ExecutionPolicy, typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
     
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
-    template<typename ExecutionPolicy>
+    template <typename Scorer = TfIdfScorer, typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentStatus status) const;
     
     std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
-    template<typename ExecutionPolicy>
+    template <typename Scorer = TfIdfScorer, typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query) const;
+
+    // То же, но дополнительно заполняет план выполнения запроса
+    template <typename Scorer = TfIdfScorer, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, QueryProfile& profile) const;
+    template <typename Scorer = TfIdfScorer, typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate, QueryProfile& profile) const;
+
+    // Поиск с ограничением времени: когда дедлайн истекает, обход списков документов
+    // прекращается и возвращается лучшее из уже насчитанного (deadline.IsExpired() == true)
+    template <typename Scorer = TfIdfScorer, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, const QueryDeadline& deadline) const;
+    template <typename Scorer = TfIdfScorer, typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate, const QueryDeadline& deadline) const;
+
+    // Постраничная выдача: до count документов, идущих в порядке IsMoreRelevant строго после after.
+    // after - последний документ предыдущей страницы того же запроса, nullopt - первая страница
+    template <typename Scorer = TfIdfScorer, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsAfter(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                const std::optional<Document>& after, size_t count) const;
+    template <typename Scorer = TfIdfScorer, typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsAfter(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                                const std::optional<Document>& after, size_t count) const;
     
+    // Шаблон плюс-слова раскрывается не больше чем в MAX_WILDCARD_EXPANSION слов словаря,
+    // шаблон минус-слова исключает все подходящие слова. Слова раскрытия ранжируются
+    // как отдельные слова запроса, а не как одно слово с общей частотой
+    static const size_t MAX_WILDCARD_EXPANSION = 64;
+    // шаблон -> слова, в которые он раскрывается
+    using WildcardExpansions = std::map<std::string, std::vector<std::string>, std::less<>>;
+
+    // Статистика коллекции по словам запроса. Шарды ShardedSearchServer складывают свои
+    // статистики и ищут по общей, чтобы IDF слова был одинаковым во всех шардах
+    struct CollectionStatistics {
+        int document_count = 0;
+        size_t total_word_count = 0;
+        double average_document_length = 0.0;
+        std::map<std::string, size_t, std::less<>> word_document_counts;
+        WildcardExpansions wildcard_expansions;
+    };
+
+    // Статистика этого сервера по плюс-словам raw_query. Шаблоны раскрываются по expansions,
+    // если они там есть, иначе по своему словарю. Бросает invalid_argument для запроса,
+    // который FindTopDocuments не сможет выполнить
+    CollectionStatistics GetQueryStatistics(std::string_view raw_query, const WildcardExpansions* expansions = nullptr) const;
+
+    // Поиск с внешней статистикой коллекции вместо статистики этого сервера
+    template <typename Scorer = TfIdfScorer, typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                           const CollectionStatistics& statistics) const;
+
     int GetDocumentCount() const;
 
     match_type MatchDocument(std::string_view raw_query, int document_id) const;
     match_type MatchDocument(std::execution::sequenced_policy policy, std::string_view raw_query, int document_id) const;
     match_type MatchDocument(std::execution::parallel_policy policy, std::string_view raw_query, int document_id) const;
+
+    // Матчит один запрос сразу с набором документов: запрос разбирается один раз,
+    // а слова проверяются по спискам документов, а не по словарям самих документов
+    std::vector<match_type> MatchDocuments(std::string_view raw_query, const std::vector<int>& document_ids) const;
+    template <typename ExecutionPolicy>
+    std::vector<match_type> MatchDocuments(ExecutionPolicy policy, std::string_view raw_query, const std::vector<int>& document_ids) const;
     
-    std::set<int>::const_iterator begin();
-    std::set<int>::const_iterator end();
+    std::set<int>::const_iterator begin() const;
+    std::set<int>::const_iterator end() const;
 
     const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
 
+    // Включает индекс отпечатков наборов слов, по которому AddDocument находит дубликаты
+    // за O(1) в среднем. Уже добавленные документы индексируются в порядке возрастания id
+    void SetDuplicateMode(DuplicateMode mode);
+    DuplicateMode GetDuplicateMode() const;
+    // Документы, чей набор слов совпал с добавленным раньше (в режиме REPORT)
+    const std::set<int>& GetDuplicateDocumentIds() const;
+
+    // Позиционный индекс нужен для фразовых запросов вида "white cat" и "white cat"~2.
+    // При включении строится по уже добавленным документам
+    void SetPositionalIndex(bool enabled);
+
 private:
     struct DocumentData {
         int rating;
         DocumentStatus status;
         std::string text;
+        int word_count = 0;
     };
 
 
     const std::set<std::string, std::less<>> stop_words_;
+    // Ключи индексов ссылаются на слова из словаря, а не на текст документа,
+    // поэтому переживают удаление документа, в котором слово встретилось первым
+    std::set<std::string, std::less<>> vocabulary_;
     std::map<int, std::map<std::string_view, double>> word_frequencies_;
     std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
     std::map<int, DocumentData> documents_;
     std::set<int> document_ids_;
+    size_t total_word_count_ = 0;
+
+    DuplicateMode duplicate_mode_ = DuplicateMode::IGNORE;
+    std::unordered_map<size_t, std::vector<int>> fingerprint_to_document_ids_;
+    std::set<int> duplicate_document_ids_;
+
+    bool positional_index_enabled_ = false;
+    std::map<std::string_view, std::map<int, std::vector<uint8_t>>> word_to_document_positions_;
 
     bool IsStopWord(std::string_view word) const;
     static bool IsValidWord(std::string_view word);
     std::vector<std::string_view> SplitIntoWordsNoStop( std::string_view text) const;
     static int ComputeAverageRating(const std::vector<int>& ratings);
+    std::string_view InternWord(std::string_view word);
+
+    static size_t ComputeFingerprint(const std::vector<std::string_view>& words);
+    std::vector<std::string_view> GetDocumentWords(int document_id) const;
+    std::optional<int> FindDuplicateOf(const std::vector<std::string_view>& words, size_t fingerprint) const;
+    void IndexFingerprint(int document_id);
+    void RemoveFingerprint(int document_id);
+    void IndexPositions(int document_id, const std::vector<std::string_view>& words);
 
     struct QueryWord {
         std::string_view data;
@@ -101,166 +233,597 @@ private:
 
     QueryWord ParseQueryWord(std::string_view text) const;
 
+    static bool IsWildcard(std::string_view word);
+    // Слово с "\\*" ищется в словаре как слово с '*'
+    std::string_view ResolveEscapes(std::string_view word) const;
+    // Добавляет в terms первые по алфавиту слова словаря, подходящие под шаблон
+    void ExpandWildcard(std::string_view pattern, std::vector<std::string_view>& terms, size_t limit) const;
+    void AddWildcardTerms(std::string_view pattern, const WildcardExpansions* expansions, std::vector<std::string_view>& terms) const;
+
+    // Слова фразы также входят в plus_words. Стоп-слова из фразы выбрасываются,
+    // позиции считаются по документу без стоп-слов
+    struct Phrase {
+        std::vector<std::string_view> words;
+        int slop = 0;
+    };
+
     struct Query {
         std::vector<std::string_view> plus_words;
         std::vector<std::string_view> minus_words;
+        std::vector<Phrase> phrases;
+        // шаблоны плюс-слов со '*' в исходном виде; их слова уже добавлены в plus_words
+        std::vector<std::string_view> wildcards;
+    };
+
+public:
+    // Буфер вызывающего для MatchDocument: после первых запросов векторы набирают
+    // нужную ёмкость, и дальше матчинг не выделяет память. Разобранный запрос внутри
+    // буфера - деталь реализации, снаружи доступны только слова последнего матчинга.
+    // Слова ссылаются на текст запроса и действительны, пока он жив
+    class MatchBuffer {
+    public:
+        const std::vector<std::string_view>& GetMatchedWords() const {
+            return matched_words_;
+        }
+        // Плюс-слова последнего запроса по возрастанию и без повторов
+        const std::vector<std::string_view>& GetPlusWords() const {
+            return query_.plus_words;
+        }
+
+    private:
+        friend class SearchServer;
+
+        std::vector<std::string_view> matched_words_;
+        Query query_;
+        std::vector<std::string_view> query_words_;
     };
-    
 
-    Query ParseQuery(std::string_view text) const;
-    double ComputeWordInverseDocumentFreq(std::string_view word) const;
+    // Найденные слова доступны через buffer.GetMatchedWords()
+    DocumentStatus MatchDocument(std::string_view raw_query, int document_id, MatchBuffer& buffer) const;
+    // Бит i выставлен, если документ содержит слово buffer.GetPlusWords()[i];
+    // 0, если документ содержит минус-слово. Запрос должен иметь не больше 64 плюс-слов
+    uint64_t MatchDocumentMask(std::string_view raw_query, int document_id, MatchBuffer& buffer) const;
+
+    // Сжатый снимок словаря для автодополнения: слово -> число содержащих его документов.
+    // Последующие изменения сервера в снимок не попадают
+    FrontCodedDictionary BuildTermDictionary() const;
+
+private:
+    // expansions - готовые раскрытия шаблонов; для отсутствующих в них шаблонов используется свой словарь
+    Query ParseQuery(std::string_view text, const WildcardExpansions* expansions = nullptr) const;
+    void ParseQuery(std::string_view text, std::vector<std::string_view>& words, Query& result,
+                    const WildcardExpansions* expansions = nullptr) const;
+    size_t ParsePhrase(const std::vector<std::string_view>& words, size_t first, Query& result) const;
+    // Бросает invalid_argument, если в запросе есть фразы, а позиционный индекс выключен
+    void CheckPhrasesSupported(const Query& query) const;
+    bool MatchesPhrases(int document_id, const std::vector<Phrase>& phrases) const;
+    size_t FilterByPhrases(std::map<int, int64_t>& document_to_relevance, const Query& query) const;
+
+    struct SearchContext {
+        QueryProfile* profile = nullptr;
+        const CollectionStatistics* statistics = nullptr;
+        const QueryDeadline* deadline = nullptr;
+        // сколько лучших документов нужно вызывающему; 0 - все. Позволяет отбросить
+        // заведомо не попадающих в выдачу кандидатов до построения Document
+        size_t result_limit = 0;
+    };
+
+    // Через сколько документов из списков проверяется дедлайн
+    static const size_t DEADLINE_CHECK_INTERVAL = 1024;
+    // Плотный массив релевантностей вместо map используется, если id занимают не больше
+    // DENSE_ID_RANGE_FACTOR * число документов и списки запроса покрывают хотя бы 1/DENSE_MIN_FILL_RATIO диапазона
+    static const size_t DENSE_ID_RANGE_FACTOR = 4;
+    static const size_t DENSE_MIN_FILL_RATIO = 8;
+
+    bool UseDenseAccumulator(const Query& query, const SearchContext& context) const;
+
+    double ComputeAverageDocumentLength() const;
+    int GetDocumentCount(const SearchContext& context) const;
+    double ComputeAverageDocumentLength(const SearchContext& context) const;
+    size_t GetWordDocumentCount(std::string_view word, size_t posting_count, const SearchContext& context) const;
     
-    template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
-    template <typename ExecutionPolicy, typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(ExecutionPolicy policy, const Query& query, DocumentPredicate document_predicate) const;
+    template <typename Scorer, typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsImpl(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate, const SearchContext& context,
+                                               const Document* after = nullptr, size_t count = MAX_RESULT_DOCUMENT_COUNT) const;
+    template <typename Scorer, typename DocumentPredicate>
+    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate, const SearchContext& context) const;
+    template <typename Scorer, typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindAllDocuments(ExecutionPolicy policy, const Query& query, DocumentPredicate document_predicate, const SearchContext& context) const;
+    template <typename Scorer, typename DocumentPredicate>
+    std::vector<Document> FindAllDocumentsDense(const Query& query, DocumentPredicate document_predicate, const SearchContext& context) const;
+    template <typename Scorer>
+    void AddTermsToProfile(const Query& query, const SearchContext& context) const;
 };
 
 
-template <typename DocumentPredicate>
+template <typename Scorer, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
-    auto query = ParseQuery(raw_query);
-    query.plus_words.erase(std::unique(query.plus_words.begin(), query.plus_words.end()), query.plus_words.end());
-    query.minus_words.erase(std::unique(query.minus_words.begin(), query.minus_words.end()), query.minus_words.end());
-    
-    auto matched_documents = FindAllDocuments(query, document_predicate);
-
-    std::sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < ::MAX_DIFFERENCE) {
-            return lhs.rating > rhs.rating;
-        }
-        else {
-            return lhs.relevance > rhs.relevance;
-        }
-        });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-    return matched_documents;
+    return FindTopDocumentsImpl<Scorer>(std::execution::seq, raw_query, document_predicate, SearchContext{});
 }
-    
 
-template <typename ExecutionPolicy, typename DocumentPredicate>
+template <typename Scorer, typename ExecutionPolicy, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate) const {
-    if constexpr(std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
-        return SearchServer::FindTopDocuments(raw_query, document_predicate);
+    return FindTopDocumentsImpl<Scorer>(policy, raw_query, document_predicate, SearchContext{});
+}
+
+template <typename Scorer, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, QueryProfile& profile) const {
+    return FindTopDocumentsImpl<Scorer>(std::execution::seq, raw_query, document_predicate, SearchContext{ &profile });
+}
+
+template <typename Scorer, typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate, QueryProfile& profile) const {
+    return FindTopDocumentsImpl<Scorer>(policy, raw_query, document_predicate, SearchContext{ &profile });
+}
+
+template <typename Scorer, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, const QueryDeadline& deadline) const {
+    return FindTopDocumentsImpl<Scorer>(std::execution::seq, raw_query, document_predicate, SearchContext{ nullptr, nullptr, &deadline });
+}
+
+template <typename Scorer, typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate, const QueryDeadline& deadline) const {
+    return FindTopDocumentsImpl<Scorer>(policy, raw_query, document_predicate, SearchContext{ nullptr, nullptr, &deadline });
+}
+
+template <typename Scorer, typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                                     const CollectionStatistics& statistics) const {
+    return FindTopDocumentsImpl<Scorer>(policy, raw_query, document_predicate, SearchContext{ nullptr, &statistics });
+}
+
+template <typename Scorer, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsAfter(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                          const std::optional<Document>& after, size_t count) const {
+    return FindTopDocumentsImpl<Scorer>(std::execution::seq, raw_query, document_predicate, SearchContext{}, after ? &*after : nullptr, count);
+}
+
+template <typename Scorer, typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsAfter(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                                          const std::optional<Document>& after, size_t count) const {
+    return FindTopDocumentsImpl<Scorer>(policy, raw_query, document_predicate, SearchContext{}, after ? &*after : nullptr, count);
+}
+
+template <typename Scorer, typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsImpl(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate, const SearchContext& context,
+                                                         const Document* after, size_t count) const {
+    QueryProfile* const profile = context.profile;
+    Query query;
+    {
+        ProfilePhaseTimer timer(profile, &QueryProfile::parse_time);
+        query = ParseQuery(raw_query, context.statistics ? &context.statistics->wildcard_expansions : nullptr);
+        query.plus_words.erase(std::unique(query.plus_words.begin(), query.plus_words.end()), query.plus_words.end());
+        query.minus_words.erase(std::unique(query.minus_words.begin(), query.minus_words.end()), query.minus_words.end());
     }
-    auto query = ParseQuery(raw_query);
     
-    query.plus_words.erase(std::unique(query.plus_words.begin(), query.plus_words.end()), query.plus_words.end());
-    query.minus_words.erase(std::unique(query.minus_words.begin(), query.minus_words.end()), query.minus_words.end());
-    
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-
-    std::sort(std::execution::par, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < ::MAX_DIFFERENCE) {
-            return lhs.rating > rhs.rating;
-        }
-        else {
-            return lhs.relevance > rhs.relevance;
-        }
-        });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    SearchContext search_context = context;
+    if (!after) {
+        search_context.result_limit = count;
+    }
+    auto matched_documents = FindAllDocuments<Scorer>(policy, query, document_predicate, search_context);
+
+    METRICS_SCOPED_TIMER(MetricTimer::SORT_TOP_K);
+    ProfilePhaseTimer timer(profile, &QueryProfile::sort_time);
+    auto candidates_end = matched_documents.end();
+    if (after) {
+        // курсор работает как порог: всё, что не хуже него, уже было на предыдущих страницах
+        candidates_end = std::partition(policy, matched_documents.begin(), matched_documents.end(), [after](const Document& document) {
+            return IsMoreRelevant(*after, document);
+            });
     }
+    const size_t candidate_count = static_cast<size_t>(candidates_end - matched_documents.begin());
+    // сортировать нужно только count лучших документов, а не всех найденных
+    const auto top_end = matched_documents.begin() + std::min(count, candidate_count);
+    std::partial_sort(policy, matched_documents.begin(), top_end, candidates_end, IsMoreRelevant);
+    matched_documents.erase(top_end, matched_documents.end());
     return matched_documents;
 }
 
-template<typename ExecutionPolicy>
+template <typename Scorer, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentStatus status) const {
-    return SearchServer::FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+    return SearchServer::FindTopDocuments<Scorer>(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
         return document_status == status;
         });
 }
 
-template<typename ExecutionPolicy>
+template <typename Scorer, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query) const {
-    return SearchServer::FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+    return SearchServer::FindTopDocuments<Scorer>(policy, raw_query, DocumentStatus::ACTUAL);
 }
 
 
-template <typename ExecutionPolicy, typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy policy, const Query& query, DocumentPredicate document_predicate) const {
-    if constexpr(std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
-        return SearchServer::FindAllDocuments(query, document_predicate);
+template <typename ExecutionPolicy>
+std::vector<match_type> SearchServer::MatchDocuments(ExecutionPolicy policy, std::string_view raw_query, const std::vector<int>& document_ids) const {
+    // неизвестный id проверяется до параллельных алгоритмов: исключение из них вызвало бы std::terminate
+    std::vector<DocumentStatus> statuses;
+    statuses.reserve(document_ids.size());
+    for (int document_id : document_ids) {
+        statuses.push_back(documents_.at(document_id).status);
     }
-    
-    ConcurrentMap<int, double> document_to_relevance(15);
-    for_each(
+
+    auto query = ParseQuery(raw_query);
+    CheckPhrasesSupported(query);
+    query.plus_words.erase(std::unique(query.plus_words.begin(), query.plus_words.end()), query.plus_words.end());
+
+    using Postings = std::map<int, double>;
+    std::vector<std::pair<std::string_view, const Postings*>> words;
+    const auto add_word = [&](std::string_view word) {
+        if (const auto it = word_to_document_freqs_.find(word); it != word_to_document_freqs_.end()) {
+            words.push_back({ it->first, &it->second });
+        }
+    };
+    for (std::string_view word : query.minus_words) {
+        add_word(word);
+    }
+    const size_t minus_count = words.size();
+    for (std::string_view word : query.plus_words) {
+        add_word(word);
+    }
+
+    // позиции документов в порядке возрастания id, чтобы проходить списки слиянием
+    std::vector<size_t> order(document_ids.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        return document_ids[lhs] < document_ids[rhs];
+    });
+
+    // contains[w][i] - есть ли слово words[w] в документе document_ids[i]. Короткий список
+    // проходится целиком вместе с отсортированными id, по длинному ищется каждый id
+    const size_t batch_size = document_ids.size();
+    std::vector<std::vector<char>> contains(words.size(), std::vector<char>(batch_size, 0));
+    std::for_each(
         policy,
-        query.plus_words.begin(),
-        query.plus_words.end(),
-        [&] (std::string_view word) {
-            
-            if(word_to_document_freqs_.count(word) == 0) {
-                return;
+        words.begin(), words.end(),
+        [&](const auto& word) {
+            const Postings& postings = *word.second;
+            std::vector<char>& word_contains = contains[&word - words.data()];
+            if (postings.size() <= batch_size * 8) {
+                auto posting = postings.begin();
+                for (size_t i : order) {
+                    posting = std::find_if(posting, postings.end(), [&](const auto& entry) {
+                        return entry.first >= document_ids[i];
+                    });
+                    if (posting == postings.end()) {
+                        break;
+                    }
+                    word_contains[i] = posting->first == document_ids[i];
+                }
+            } else {
+                for (size_t i = 0; i < batch_size; ++i) {
+                    word_contains[i] = postings.count(document_ids[i]) > 0;
+                }
             }
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (auto [document_id, freq]: word_to_document_freqs_.at(word)) {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id].ref_to_value += static_cast<double>(freq * inverse_document_freq);
+        }
+    );
+
+    std::vector<match_type> result(batch_size);
+    std::vector<size_t> positions(batch_size);
+    std::iota(positions.begin(), positions.end(), 0);
+    std::transform(
+        policy,
+        positions.begin(), positions.end(),
+        result.begin(),
+        [&](size_t i) {
+            std::vector<std::string_view> matched_words;
+            for (size_t w = 0; w < minus_count; ++w) {
+                if (contains[w][i]) {
+                    return match_type{ matched_words, statuses[i] };
+                }
+            }
+            if (!MatchesPhrases(document_ids[i], query.phrases)) {
+                return match_type{ matched_words, statuses[i] };
+            }
+            for (size_t w = minus_count; w < words.size(); ++w) {
+                if (contains[w][i]) {
+                    matched_words.push_back(words[w].first);
                 }
             }
+            return match_type{ matched_words, statuses[i] };
         }
     );
+    return result;
+}
+
+template <typename Scorer, typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy policy, const Query& query, DocumentPredicate document_predicate, const SearchContext& context) const {
+    if constexpr(std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+        return SearchServer::FindAllDocuments<Scorer>(query, document_predicate, context);
+    }
+    
+    METRICS_SCOPED_TIMER(MetricTimer::FIND_ALL_DOCUMENTS);
+    QueryProfile* const profile = context.profile;
+    AddTermsToProfile<Scorer>(query, context);
+    const int document_count = GetDocumentCount(context);
+    const double average_document_length = ComputeAverageDocumentLength(context);
+    ConcurrentMap<int, int64_t> document_to_relevance(15);
+    std::atomic<size_t> dropped_by_predicate = 0;
+    std::atomic<size_t> postings_visited = 0;
+    {
+        ProfilePhaseTimer timer(profile, &QueryProfile::accumulate_time);
+        for_each(
+            policy,
+            query.plus_words.begin(),
+            query.plus_words.end(),
+            [&] (std::string_view word) {
+                
+                const auto postings = word_to_document_freqs_.find(word);
+                if (postings == word_to_document_freqs_.end() || (context.deadline && context.deadline->Check())) {
+                    return;
+                }
+                size_t visited = 0;
+                const double word_weight = Scorer::ComputeWordWeight(
+                document_count, GetWordDocumentCount(word, postings->second.size(), context));
+                for (auto [document_id, freq]: postings->second) {
+                    if (context.deadline && visited % DEADLINE_CHECK_INTERVAL == 0 && context.deadline->Check()) {
+                        break;
+                    }
+                    ++visited;
+                    const auto& document_data = documents_.at(document_id);
+                    if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                        document_to_relevance[document_id].ref_to_value += QuantizeRelevance(Scorer::ComputeRelevance(
+                            freq, word_weight, document_data.word_count, average_document_length));
+                    } else {
+                        METRICS_ADD(MetricCounter::DOCUMENTS_FILTERED, 1);
+                        if (profile) {
+                            dropped_by_predicate.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                }
+                METRICS_ADD(MetricCounter::POSTINGS_SCANNED, visited);
+                postings_visited.fetch_add(visited, std::memory_order_relaxed);
+            }
+        );
+    }
     
+    ProfilePhaseTimer timer(profile, &QueryProfile::exclude_time);
+    std::atomic<size_t> dropped_by_minus_words = 0;
+    // минус-слова исключаются по их спискам документов, даже если дедлайн истёк:
+    // частичный результат может быть неполным, но не должен быть неверным
     for_each(
     policy, 
     query.minus_words.begin(),
     query.minus_words.end(),
     [&](std::string_view word) {
-        for (const int document_id : document_ids_) {
-            if (word_frequencies_.at(document_id).count(word) == 0) {
-                continue;
-            }
-            document_to_relevance.erase(document_id);
+        const auto postings = word_to_document_freqs_.find(word);
+        if (postings == word_to_document_freqs_.end()) {
+            return;
+        }
+        for (const auto& [document_id, _] : postings->second) {
+            const size_t erased = document_to_relevance.erase(document_id);
+            METRICS_ADD(MetricCounter::DOCUMENTS_FILTERED, erased);
+            METRICS_ADD(MetricCounter::CANDIDATES_ACCUMULATED, erased);
+            dropped_by_minus_words.fetch_add(erased, std::memory_order_relaxed);
         }
 
     });
     
     auto temp = document_to_relevance.BuildOrdinaryMap();
+    METRICS_ADD(MetricCounter::CANDIDATES_ACCUMULATED, temp.size());
+    const size_t dropped_by_phrases = FilterByPhrases(temp, query);
+    if (profile) {
+        profile->accumulator = Accumulator::CONCURRENT_MAP;
+        profile->postings_visited += postings_visited;
+        profile->postings_dropped_by_predicate += dropped_by_predicate;
+        profile->documents_dropped_by_minus_words += dropped_by_minus_words;
+        profile->documents_dropped_by_phrases += dropped_by_phrases;
+        profile->candidates_after_plus_words += temp.size() + dropped_by_minus_words + dropped_by_phrases;
+    }
     std::vector<Document> matched_documents;
     for (const auto [document_id, relevance] : temp) {
-        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+        matched_documents.push_back({ document_id, DequantizeRelevance(relevance), documents_.at(document_id).rating });
     }
     return matched_documents;
 }
 
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
+template <typename Scorer, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate, const SearchContext& context) const {
+    if (UseDenseAccumulator(query, context)) {
+        return FindAllDocumentsDense<Scorer>(query, document_predicate, context);
+    }
+    METRICS_SCOPED_TIMER(MetricTimer::FIND_ALL_DOCUMENTS);
+    QueryProfile* const profile = context.profile;
+    AddTermsToProfile<Scorer>(query, context);
+    const int document_count = GetDocumentCount(context);
+    const double average_document_length = ComputeAverageDocumentLength(context);
+    std::map<int, int64_t> document_to_relevance;
+    size_t visited = 0;
+    {
+        ProfilePhaseTimer timer(profile, &QueryProfile::accumulate_time);
+        for (std::string_view word: query.plus_words) {
+            if (context.deadline && context.deadline->Check()) {
+                break;
+            }
+            const auto postings = word_to_document_freqs_.find(word);
+            if (postings == word_to_document_freqs_.end()) {
+                continue;
+            }
+            const double word_weight = Scorer::ComputeWordWeight(
+                document_count, GetWordDocumentCount(word, postings->second.size(), context));
+            
+            for (auto [document_id, freq]: postings->second) {
+                if (context.deadline && visited % DEADLINE_CHECK_INTERVAL == 0 && context.deadline->Check()) {
+                    break;
+                }
+                ++visited;
+                const auto& document_data = documents_.at(document_id);
+                if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                    document_to_relevance[document_id] += QuantizeRelevance(Scorer::ComputeRelevance(
+                        freq, word_weight, document_data.word_count, average_document_length));
+                } else {
+                    METRICS_ADD(MetricCounter::DOCUMENTS_FILTERED, 1);
+                    if (profile) {
+                        ++profile->postings_dropped_by_predicate;
+                    }
+                }
+            }
+        }
+    }
+    // дедлайн может оборвать список на середине, поэтому считаются реально просмотренные записи
+    METRICS_ADD(MetricCounter::POSTINGS_SCANNED, visited);
+    METRICS_ADD(MetricCounter::CANDIDATES_ACCUMULATED, document_to_relevance.size());
+    if (profile) {
+        profile->accumulator = Accumulator::MAP;
+        profile->postings_visited += visited;
+        profile->candidates_after_plus_words += document_to_relevance.size();
+    }
     
-    std::map<int, double> document_to_relevance;
-    for (std::string_view word: query.plus_words) {
-        if(word_to_document_freqs_.count(word) == 0) {
+    ProfilePhaseTimer timer(profile, &QueryProfile::exclude_time);
+    for (std::string_view word : query.minus_words) {
+        const auto postings = word_to_document_freqs_.find(word);
+        if (postings == word_to_document_freqs_.end()) {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        
-        for (auto [document_id, freq]: word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += freq * inverse_document_freq;
+        for (const auto& [document_id, _] : postings->second) {
+            const size_t erased = document_to_relevance.erase(document_id);
+            METRICS_ADD(MetricCounter::DOCUMENTS_FILTERED, erased);
+            if (profile) {
+                profile->documents_dropped_by_minus_words += erased;
             }
         }
     }
-    
-    for (const int document_id : document_ids_) {
+    const size_t dropped_by_phrases = FilterByPhrases(document_to_relevance, query);
+    if (profile) {
+        profile->documents_dropped_by_phrases += dropped_by_phrases;
+    }
+    std::vector<Document> matched_documents;
+    for (const auto [document_id, relevance] : document_to_relevance) {
+        matched_documents.push_back({ document_id, DequantizeRelevance(relevance), documents_.at(document_id).rating });
+    }
+    return matched_documents;
+}
+
+// Последовательный поиск с плотным массивом релевантностей, индексированным id документа.
+// Сложение по спискам, сбор кандидатов и отсечение по порогу top-K выполняют векторные ядра simd_kernels.h
+template <typename Scorer, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocumentsDense(const Query& query, DocumentPredicate document_predicate, const SearchContext& context) const {
+    METRICS_SCOPED_TIMER(MetricTimer::FIND_ALL_DOCUMENTS);
+    QueryProfile* const profile = context.profile;
+    AddTermsToProfile<Scorer>(query, context);
+    const int document_count = GetDocumentCount(context);
+    const double average_document_length = ComputeAverageDocumentLength(context);
+    const size_t id_range = static_cast<size_t>(*document_ids_.rbegin()) + 1;
+    std::vector<int64_t> document_to_relevance(id_range);
+    std::vector<uint8_t> matched(id_range);
+    std::vector<int32_t> ids;
+    std::vector<int64_t> contributions;
+    size_t visited = 0;
+    size_t matched_count = 0;
+    size_t dropped_by_predicate = 0;
+    {
+        ProfilePhaseTimer timer(profile, &QueryProfile::accumulate_time);
+        for (std::string_view word : query.plus_words) {
+            if (context.deadline && context.deadline->Check()) {
+                break;
+            }
+            const auto postings = word_to_document_freqs_.find(word);
+            if (postings == word_to_document_freqs_.end()) {
+                continue;
+            }
+            const double word_weight = Scorer::ComputeWordWeight(
+                document_count, GetWordDocumentCount(word, postings->second.size(), context));
+            ids.clear();
+            contributions.clear();
+            for (auto [document_id, freq] : postings->second) {
+                if (context.deadline && visited % DEADLINE_CHECK_INTERVAL == 0 && context.deadline->Check()) {
+                    break;
+                }
+                ++visited;
+                const auto& document_data = documents_.at(document_id);
+                if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                    ids.push_back(document_id);
+                    contributions.push_back(QuantizeRelevance(Scorer::ComputeRelevance(
+                        freq, word_weight, document_data.word_count, average_document_length)));
+                    matched_count += 1 - matched[document_id];
+                    matched[document_id] = 1;
+                } else {
+                    METRICS_ADD(MetricCounter::DOCUMENTS_FILTERED, 1);
+                    ++dropped_by_predicate;
+                }
+            }
+            // в одном списке id не повторяются
+            ScatterAdd(document_to_relevance.data(), ids.data(), contributions.data(), ids.size());
+        }
+    }
+    METRICS_ADD(MetricCounter::POSTINGS_SCANNED, visited);
+    // как и в путях с map, кандидаты считаются до исключения минус-слов
+    METRICS_ADD(MetricCounter::CANDIDATES_ACCUMULATED, matched_count);
+
+    size_t dropped_by_minus_words = 0;
+    {
+        ProfilePhaseTimer timer(profile, &QueryProfile::exclude_time);
         for (std::string_view word : query.minus_words) {
-            if (word_frequencies_.at(document_id).count(word) == 0) {
+            const auto postings = word_to_document_freqs_.find(word);
+            if (postings == word_to_document_freqs_.end()) {
                 continue;
             }
-            document_to_relevance.erase(document_id);
+            for (const auto& [document_id, _] : postings->second) {
+                METRICS_ADD(MetricCounter::DOCUMENTS_FILTERED, matched[document_id]);
+                dropped_by_minus_words += matched[document_id];
+                matched[document_id] = 0;
+            }
+        }
+    }
+    if (profile) {
+        profile->accumulator = Accumulator::DENSE;
+        profile->postings_visited += visited;
+        profile->postings_dropped_by_predicate += dropped_by_predicate;
+        profile->candidates_after_plus_words += matched_count;
+        profile->documents_dropped_by_minus_words += dropped_by_minus_words;
+    }
+
+    std::vector<int32_t> candidates(id_range);
+    candidates.resize(CollectMarked(matched.data(), id_range, candidates.data()));
+    if (context.result_limit > 0 && candidates.size() > context.result_limit) {
+        // документы с релевантностью ниже limit-й по величине в выдачу не попадут;
+        // равные порогу сохраняются, их порядок решают рейтинг и id
+        std::vector<int64_t> relevances(candidates.size());
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            relevances[i] = document_to_relevance[candidates[i]];
         }
+        std::vector<int64_t> ranked = relevances;
+        const auto kth = ranked.begin() + (context.result_limit - 1);
+        std::nth_element(ranked.begin(), kth, ranked.end(), std::greater<>());
+        std::vector<int32_t> selected(relevances.size());
+        selected.resize(SelectAtLeast(relevances.data(), relevances.size(), *kth, selected.data()));
+        for (int32_t& index : selected) {
+            index = candidates[index];
+        }
+        candidates.swap(selected);
     }
+
     std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+    matched_documents.reserve(candidates.size());
+    for (const int32_t document_id : candidates) {
+        matched_documents.push_back({ document_id, DequantizeRelevance(document_to_relevance[document_id]), documents_.at(document_id).rating });
     }
     return matched_documents;
 }
 
+template <typename Scorer>
+void SearchServer::AddTermsToProfile(const Query& query, const SearchContext& context) const {
+    if (!context.profile) {
+        return;
+    }
+    QueryProfile& profile = *context.profile;
+    for (std::string_view word : query.plus_words) {
+        QueryTermProfile term{ std::string(word) };
+        if (const auto postings = word_to_document_freqs_.find(word); postings != word_to_document_freqs_.end()) {
+            term.posting_count = postings->second.size();
+            term.word_weight = Scorer::ComputeWordWeight(
+                GetDocumentCount(context), GetWordDocumentCount(word, term.posting_count, context));
+        }
+        profile.terms.push_back(std::move(term));
+    }
+    for (std::string_view word : query.minus_words) {
+        QueryTermProfile term{ std::string(word), true };
+        if (const auto postings = word_to_document_freqs_.find(word); postings != word_to_document_freqs_.end()) {
+            term.posting_count = postings->second.size();
+        }
+        profile.terms.push_back(std::move(term));
+    }
+}
+
 void AddDocument(SearchServer& search_server, int document_id, std::string_view document, DocumentStatus status,
     const std::vector<int>& ratings);
 
@@ -0,0 +1,851 @@
+// Тесты поискового сервера. Собираются отдельно от main.cpp, как и бенчмарк
+#include "async_search_server.h"
+#include "metrics.h"
+#include "positional_index.h"
+#include "query_deadline.h"
+#include "query_protocol.h"
+#include "ranked_pagination.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+#include "sharded_search_server.h"
+#include "simd_kernels.h"
+#include "synthetic_corpus.h"
+#include "term_dictionary.h"
+#include "test_framework.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <execution>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+SearchServer MakeAnimalServer() {
+    SearchServer search_server("and with"s);
+    int id = 0;
+    for (const string& text : {"white cat and yellow hat"s, "curly cat curly tail"s, "nasty dog with big eyes"s, "nasty pigeon john"s}) {
+        search_server.AddDocument(++id, text, DocumentStatus::ACTUAL, {1, 2});
+    }
+    return search_server;
+}
+
+void TestTfIdfKeepsOriginalRelevance() {
+    const SearchServer search_server = MakeAnimalServer();
+    // значения исходной версии сервера: 0.866434, 0.231049, 0.173287, 0.173287
+    const vector<pair<int, double>> expected = {
+        {2, 2.0 / 4 * log(4.0) + 1.0 / 4 * log(2.0)},
+        {4, 1.0 / 3 * log(2.0)},
+        {1, 1.0 / 4 * log(2.0)},
+        {3, 1.0 / 4 * log(2.0)},
+    };
+    const auto by_default = search_server.FindTopDocuments("curly nasty cat"s);
+    const auto tf_idf = search_server.FindTopDocuments<TfIdfScorer>(execution::seq, "curly nasty cat"s);
+    ASSERT_EQUAL(by_default.size(), expected.size());
+    ASSERT_EQUAL(tf_idf.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQUAL(by_default[i].id, expected[i].first);
+        ASSERT(abs(by_default[i].relevance - expected[i].second) < MAX_DIFFERENCE);
+        ASSERT_EQUAL(tf_idf[i].id, by_default[i].id);
+        ASSERT(tf_idf[i].relevance == by_default[i].relevance);
+    }
+}
+
+void TestBm25Relevance() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "cat bird fish mouse"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(3, "dog bird"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(4, "fish mouse"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(5, "cat cat cat bird"s, DocumentStatus::ACTUAL, {1});
+    // N = 5, средняя длина 2.8; cat есть в трёх документах
+    const double idf = log((5 - 3 + 0.5) / (3 + 0.5) + 1.0);
+    const auto bm25 = [&](double occurrences, double length) {
+        const double norm = Bm25Scorer::K1 * (1.0 - Bm25Scorer::B + Bm25Scorer::B * length / 2.8);
+        return idf * occurrences * (Bm25Scorer::K1 + 1.0) / (occurrences + norm);
+    };
+    const auto documents = search_server.FindTopDocuments<Bm25Scorer>(execution::seq, "cat"s);
+    // частота насыщается: три вхождения дают меньше трёхкратного веса,
+    // а из документов с одним вхождением выше короткий
+    const vector<pair<int, double>> expected = {{5, bm25(3, 4)}, {1, bm25(1, 2)}, {2, bm25(1, 4)}};
+    ASSERT_EQUAL(documents.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQUAL(documents[i].id, expected[i].first);
+        ASSERT(abs(documents[i].relevance - expected[i].second) < MAX_DIFFERENCE);
+    }
+    ASSERT(documents[0].relevance < 3 * documents[2].relevance);
+
+    // TF-IDF при тех же данных ставит документы в порядке доли слова
+    const auto tf_idf = search_server.FindTopDocuments(execution::seq, "cat"s);
+    ASSERT_EQUAL(tf_idf[0].id, 5);
+    ASSERT_EQUAL(tf_idf[1].id, 1);
+    ASSERT_EQUAL(tf_idf[2].id, 2);
+}
+
+void TestProfileCountsVisitedPostings() {
+    const SearchServer search_server = MakeAnimalServer();
+    const auto all = [](int, DocumentStatus, int) { return true; };
+    // cat - 2 документа, curly - 1, nasty - 2
+    QueryProfile seq_profile;
+    search_server.FindTopDocuments("curly nasty cat"s, all, seq_profile);
+    ASSERT_EQUAL(seq_profile.postings_visited, 5u);
+    QueryProfile par_profile;
+    search_server.FindTopDocuments(execution::par, "curly nasty cat"s, all, par_profile);
+    ASSERT_EQUAL(par_profile.postings_visited, 5u);
+}
+
+void TestNumaShardedSearchRethrowsAfterAllShards() {
+    ShardedSearchServer search_server("and with"s, 8, ShardPlacement::NUMA_NODE);
+    for (int id = 0; id < 32; ++id) {
+        search_server.AddDocument(id, "white cat number"s + to_string(id), DocumentStatus::ACTUAL, {1});
+    }
+    // предикат бросает в каждом шарде, пока другие шарды ещё работают
+    const auto failing = [](int, DocumentStatus, int) -> bool { throw invalid_argument("predicate"s); };
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_THROWS(search_server.FindTopDocuments(execution::seq, "white cat"s, failing), invalid_argument);
+    }
+    ASSERT_EQUAL(search_server.FindTopDocuments("white cat"s).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+}
+
+void TestParallelShardedSearchReportsErrors() {
+    ShardedSearchServer search_server("and with"s, 4);
+    for (int id = 0; id < 16; ++id) {
+        search_server.AddDocument(id, "white cat number"s + to_string(id), DocumentStatus::ACTUAL, {1});
+    }
+    ASSERT_THROWS(search_server.FindTopDocuments(execution::par, "\"white cat\""s), invalid_argument);
+    const auto failing = [](int, DocumentStatus, int) -> bool { throw invalid_argument("predicate"s); };
+    ASSERT_THROWS(search_server.FindTopDocuments(execution::par, "white cat"s, failing), invalid_argument);
+}
+
+void TestShardedWildcardMatchesSingleServer() {
+    SearchServer single("and with"s);
+    ShardedSearchServer sharded("and with"s, 3);
+    const vector<string> texts = {"cat catalog"s, "caterpillar dog"s, "category cat"s, "car cart"s, "catfish"s, "dog"s};
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        single.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+        sharded.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+    }
+    for (const string& query : {"cat*"s, "ca* -dog"s, "cat* car"s}) {
+        const auto expected = single.FindTopDocuments(execution::seq, query);
+        const auto actual = sharded.FindTopDocuments(execution::par, query);
+        ASSERT_EQUAL_HINT(actual.size(), expected.size(), query);
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL_HINT(actual[i].id, expected[i].id, query);
+            ASSERT_HINT(abs(actual[i].relevance - expected[i].relevance) < MAX_DIFFERENCE, query);
+        }
+    }
+}
+
+void TestMatchDocumentsAgreesWithMatchDocument() {
+    const SearchServer search_server = MakeAnimalServer();
+    const vector<int> document_ids = {4, 2, 1, 3, 2};
+    for (const string& query : {"curly nasty cat"s, "cat -tail"s, "hat dog -john"s, "parrot"s}) {
+        const auto matches = search_server.MatchDocuments(execution::par, query, document_ids);
+        ASSERT_EQUAL(matches.size(), document_ids.size());
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            const auto [expected_words, expected_status] = search_server.MatchDocument(query, document_ids[i]);
+            const auto& [words, status] = matches[i];
+            ASSERT_HINT(words == expected_words, query);
+            ASSERT_HINT(status == expected_status, query);
+        }
+    }
+    ASSERT_THROWS(search_server.MatchDocuments(execution::par, "cat"s, {1, 42, 2}), out_of_range);
+    ASSERT_THROWS(search_server.MatchDocuments("cat"s, {42}), out_of_range);
+}
+
+void TestPositionsVarintRoundTrip() {
+    const vector<uint32_t> positions = {0, 1, 127, 128, 300, 16'383, 16'384, 2'097'152, 4'294'967'295u};
+    const vector<uint8_t> encoded = EncodePositions(positions);
+    // разности 0, 1, 126 и 1 занимают по байту, большие - по несколько
+    ASSERT_EQUAL(encoded[0], 0u);
+    ASSERT_EQUAL(encoded[1], 1u);
+    ASSERT_EQUAL(encoded[2], 126u);
+    ASSERT_EQUAL(encoded[3], 1u);
+    vector<uint32_t> decoded = {42};
+    DecodePositions(encoded, decoded);
+    ASSERT(decoded == positions);
+    DecodePositions({}, decoded);
+    ASSERT(decoded.empty());
+}
+
+SearchServer MakePhraseServer() {
+    SearchServer search_server("and the"s);
+    search_server.SetPositionalIndex(true);
+    search_server.AddDocument(1, "the white cat sat on the mat"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "cat white and black"s, DocumentStatus::ACTUAL, {2});
+    search_server.AddDocument(3, "cat sat"s, DocumentStatus::ACTUAL, {3});
+    search_server.AddDocument(4, "cat cat sat"s, DocumentStatus::ACTUAL, {4});
+    return search_server;
+}
+
+vector<int> FindIds(const SearchServer& search_server, const string& query) {
+    vector<int> ids;
+    for (const Document& document : search_server.FindTopDocuments(execution::seq, query)) {
+        ids.push_back(document.id);
+    }
+    sort(ids.begin(), ids.end());
+    return ids;
+}
+
+void TestPhraseQueryParsing() {
+    const SearchServer search_server = MakePhraseServer();
+    // стоп-слова внутри фразы пропускаются, слова после фразы остаются плюс-словами
+    ASSERT(FindIds(search_server, "\"the white cat\""s) == vector<int>({1}));
+    ASSERT(FindIds(search_server, "\"white cat\" -mat"s) == vector<int>{});
+    ASSERT(FindIds(search_server, "\"cat sat\" black"s) == vector<int>({1, 3, 4}));
+    ASSERT_THROWS(search_server.FindTopDocuments(execution::seq, "\"white cat"s), invalid_argument);
+    ASSERT_THROWS(search_server.FindTopDocuments(execution::seq, "\"white -cat\""s), invalid_argument);
+    ASSERT_THROWS(search_server.FindTopDocuments(execution::seq, "\"white ca*\""s), invalid_argument);
+    ASSERT_THROWS(search_server.FindTopDocuments(execution::seq, "\"white cat\"~"s), invalid_argument);
+    ASSERT_THROWS(search_server.FindTopDocuments(execution::seq, "\"white cat\"~x"s), invalid_argument);
+    ASSERT_THROWS(search_server.FindTopDocuments(execution::seq, "\"white cat\"~-1"s), invalid_argument);
+    ASSERT_THROWS(search_server.FindTopDocuments(execution::seq, "\"white cat\"!"s), invalid_argument);
+    ASSERT_THROWS(MakeAnimalServer().FindTopDocuments(execution::seq, "\"white cat\""s), invalid_argument);
+}
+
+void TestMatchingAppliesPhrases() {
+    SearchServer search_server("and"s);
+    search_server.SetPositionalIndex(true);
+    search_server.AddDocument(1, "cat white"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "white cat"s, DocumentStatus::ACTUAL, {1});
+    const string query = "\"white cat\""s;
+    ASSERT(FindIds(search_server, query) == vector<int>({2}));
+    const vector<string_view> both = {"cat"sv, "white"sv};
+    ASSERT(get<0>(search_server.MatchDocument(query, 1)).empty());
+    ASSERT(get<0>(search_server.MatchDocument(query, 2)) == both);
+    ASSERT(get<0>(search_server.MatchDocument(execution::par, query, 1)).empty());
+    ASSERT(get<0>(search_server.MatchDocument(execution::par, query, 2)) == both);
+    const auto matches = search_server.MatchDocuments(execution::par, query, {1, 2});
+    ASSERT(get<0>(matches[0]).empty());
+    ASSERT(get<0>(matches[1]) == both);
+    SearchServer::MatchBuffer buffer;
+    ASSERT_EQUAL(search_server.MatchDocumentMask(query, 1, buffer), 0u);
+    ASSERT_EQUAL(search_server.MatchDocumentMask(query, 2, buffer), 3u);
+    // близость в окне: порядок не важен
+    ASSERT(get<0>(search_server.MatchDocument("\"white cat\"~1"s, 1)) == both);
+
+    // без позиционного индекса матчинг фраз бросает, как и поиск
+    const SearchServer plain = MakeAnimalServer();
+    ASSERT_THROWS(plain.MatchDocument(query, 1), invalid_argument);
+    ASSERT_THROWS(plain.MatchDocument(execution::par, query, 1), invalid_argument);
+    ASSERT_THROWS(plain.MatchDocuments(execution::par, query, {1, 2}), invalid_argument);
+    ASSERT_THROWS(plain.MatchDocumentMask(query, 1, buffer), invalid_argument);
+}
+
+void TestProximityQueries() {
+    const SearchServer search_server = MakePhraseServer();
+    ASSERT(FindIds(search_server, "\"white cat\""s) == vector<int>({1}));
+    // в окне из slop + 2 слов порядок не важен
+    ASSERT(FindIds(search_server, "\"white cat\"~1"s) == vector<int>({1, 2}));
+    ASSERT(FindIds(search_server, "\"white sat\"~1"s) == vector<int>({1}));
+    ASSERT(FindIds(search_server, "\"white sat\"~0"s) == vector<int>{});
+    // повторённое слово должно встретиться в окне столько же раз
+    ASSERT(FindIds(search_server, "\"cat cat\"~1"s) == vector<int>({4}));
+    ASSERT(FindIds(search_server, "\"cat cat sat\"~1"s) == vector<int>({4}));
+    ASSERT(FindIds(search_server, "\"cat cat\""s) == vector<int>({4}));
+    ASSERT(HasPhraseMatch({{3, 7}, {3, 7}}, 5));
+    ASSERT(!HasPhraseMatch({{3}, {3}}, 5));
+    ASSERT(!HasPhraseMatch({{3}, {}}, 5));
+}
+
+vector<int> RemainingIds(DuplicateMode mode) {
+    SearchServer search_server("and"s);
+    search_server.SetDuplicateMode(mode);
+    search_server.AddDocument(5, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(3, "nasty rat funny pet"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(4, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(1, "rat funny nasty pet rat"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "curly hair funny pet with"s, DocumentStatus::ACTUAL, {1});
+    RemoveDuplicates(search_server);
+    return vector<int>(search_server.begin(), search_server.end());
+}
+
+void TestDuplicateModesKeepSmallestId() {
+    ASSERT(RemainingIds(DuplicateMode::IGNORE) == vector<int>({1, 2}));
+    ASSERT(RemainingIds(DuplicateMode::REPORT) == vector<int>({1, 2}));
+
+    SearchServer search_server("and"s);
+    search_server.SetDuplicateMode(DuplicateMode::REPORT);
+    search_server.AddDocument(7, "white cat"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(3, "cat white"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(5, "white cat cat"s, DocumentStatus::ACTUAL, {1});
+    ASSERT(search_server.GetDuplicateDocumentIds() == set<int>({5, 7}));
+    // при удалении оригинала его место занимает следующая по id копия
+    search_server.RemoveDocument(3);
+    ASSERT(search_server.GetDuplicateDocumentIds() == set<int>({7}));
+
+    search_server.SetDuplicateMode(DuplicateMode::REJECT);
+    try {
+        search_server.AddDocument(1, "cat and white"s, DocumentStatus::ACTUAL, {1});
+        ASSERT_HINT(false, "duplicate was added"s);
+    } catch (const invalid_argument& e) {
+        ASSERT_EQUAL(string(e.what()), "Document is a duplicate of document 5"s);
+    }
+}
+
+void TestProfileReportsAccumulator() {
+    const SearchServer search_server = MakeAnimalServer();
+    const auto odd = [](int document_id, DocumentStatus, int) { return document_id % 2 == 1; };
+    const string query = "curly nasty cat hat -john"s;
+    QueryProfile dense_profile;
+    const auto dense = search_server.FindTopDocuments(query, odd, dense_profile);
+    QueryProfile par_profile;
+    const auto par = search_server.FindTopDocuments(execution::par, query, odd, par_profile);
+    // профиль не меняет план: последовательный поиск по плотным id идёт через плотный массив
+    ASSERT(dense_profile.accumulator == Accumulator::DENSE);
+    ASSERT(par_profile.accumulator == Accumulator::CONCURRENT_MAP);
+    ASSERT_EQUAL(dense.size(), par.size());
+    ASSERT_EQUAL(dense_profile.terms.size(), par_profile.terms.size());
+    ASSERT_EQUAL(dense_profile.postings_visited, par_profile.postings_visited);
+    ASSERT_EQUAL(dense_profile.postings_dropped_by_predicate, par_profile.postings_dropped_by_predicate);
+    ASSERT_EQUAL(dense_profile.candidates_after_plus_words, par_profile.candidates_after_plus_words);
+    ASSERT_EQUAL(dense_profile.documents_dropped_by_minus_words, par_profile.documents_dropped_by_minus_words);
+    ASSERT_EQUAL(dense_profile.candidates_after_plus_words, 2u);
+    ASSERT_EQUAL(dense_profile.documents_dropped_by_minus_words, 0u);
+
+    SearchServer sparse("and"s);
+    sparse.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    sparse.AddDocument(1000, "black cat"s, DocumentStatus::ACTUAL, {1});
+    QueryProfile map_profile;
+    sparse.FindTopDocuments("cat"s, odd, map_profile);
+    ASSERT(map_profile.accumulator == Accumulator::MAP);
+}
+
+void TestTermDictionary() {
+    vector<string> words;
+    for (int i = 0; i < 1000; ++i) {
+        words.push_back("term"s + to_string(100'000 + i * 7));
+    }
+    sort(words.begin(), words.end());
+    vector<string_view> terms(words.begin(), words.end());
+    vector<uint32_t> values;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        values.push_back(static_cast<uint32_t>(i * 37 % 101));
+    }
+    const FrontCodedDictionary dictionary(terms, values);
+    ASSERT_EQUAL(dictionary.size(), terms.size());
+    for (size_t i = 0; i < terms.size(); i += 13) {
+        ASSERT_EQUAL(dictionary.Find(terms[i]).value_or(1000), values[i]);
+    }
+    ASSERT(!dictionary.Find("term"s));
+    ASSERT(!dictionary.Find("zzz"s));
+    // общие префиксы соседних терминов хранятся один раз: меньше, чем одни объекты std::string
+    ASSERT(dictionary.GetMemoryUsage() < terms.size() * sizeof(string));
+
+    for (const string& prefix : {"term1"s, "term104"s, "term1069"s, "x"s, ""s}) {
+        vector<pair<string, uint32_t>> expected;
+        for (size_t i = 0; i < terms.size(); ++i) {
+            if (terms[i].substr(0, prefix.size()) == prefix) {
+                expected.emplace_back(terms[i], values[i]);
+            }
+        }
+        sort(expected.begin(), expected.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.second != rhs.second ? lhs.second > rhs.second : lhs.first < rhs.first;
+        });
+        expected.resize(min<size_t>(expected.size(), 10));
+        ASSERT_HINT(dictionary.Complete(prefix, 10) == expected, prefix);
+    }
+    ASSERT(dictionary.Complete("term"s, 0).empty());
+    ASSERT_THROWS(FrontCodedDictionary({"b"sv, "a"sv}, {1, 2}), invalid_argument);
+}
+
+void TestMinusWildcardExcludesAllTerms() {
+    SearchServer search_server("and"s);
+    ShardedSearchServer sharded("and"s, 3);
+    const auto add = [&](int id, const string& text) {
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {1});
+        sharded.AddDocument(id, text, DocumentStatus::ACTUAL, {1});
+    };
+    add(1, "dog ca69"s);
+    add(2, "dog cat"s);
+    add(3, "dog bird"s);
+    for (int i = 0; i < 70; ++i) {
+        add(10 + i, "bird ca"s + (i < 10 ? "0"s : ""s) + to_string(i));
+    }
+    // плюс-шаблон раскрывается в первые MAX_WILDCARD_EXPANSION слов, ca69 и cat в них не входят
+    ASSERT(get<0>(search_server.MatchDocument("ca*"s, 2)).empty());
+    // минус-шаблон исключает все слова с префиксом
+    ASSERT(FindIds(search_server, "dog -ca*"s) == vector<int>({3}));
+    const string query = "dog -ca*"s;
+    ASSERT(get<0>(search_server.MatchDocument(query, 1)).empty());
+    const auto matches = search_server.MatchDocuments(execution::par, query, {1, 2, 3});
+    ASSERT(get<0>(matches[0]).empty());
+    ASSERT(get<0>(matches[1]).empty());
+    ASSERT(get<0>(matches[2]) == vector<string_view>({"dog"sv}));
+    const auto sharded_result = sharded.FindTopDocuments(execution::par, query);
+    ASSERT_EQUAL(sharded_result.size(), 1u);
+    ASSERT_EQUAL(sharded_result[0].id, 3);
+}
+
+void TestWildcardTermsAreScoredSeparately() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "cat cats catalog"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "cat dog bird"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(3, "dog bird fish"s, DocumentStatus::ACTUAL, {1});
+    // cat* раскрывается в cat, catalog и cats, и каждое слово добавляет свой TF-IDF
+    const double cat = log(3.0 / 2.0) / 3.0;
+    const double rare = log(3.0) / 3.0;
+    const auto documents = search_server.FindTopDocuments(execution::seq, "cat*"s);
+    ASSERT_EQUAL(documents.size(), 2u);
+    ASSERT_EQUAL(documents[0].id, 1);
+    ASSERT(abs(documents[0].relevance - (cat + 2 * rare)) < MAX_DIFFERENCE);
+    ASSERT_EQUAL(documents[1].id, 2);
+    ASSERT(abs(documents[1].relevance - cat) < MAX_DIFFERENCE);
+    // то же, что запрос из трёх слов
+    const auto written = search_server.FindTopDocuments(execution::seq, "cat cats catalog"s);
+    ASSERT_EQUAL(written.size(), documents.size());
+    for (size_t i = 0; i < written.size(); ++i) {
+        ASSERT_EQUAL(written[i].id, documents[i].id);
+        ASSERT(written[i].relevance == documents[i].relevance);
+    }
+}
+
+void TestWildcardEscapes() {
+    ASSERT(MatchesWildcard("ca*"s, "cat"s));
+    ASSERT(MatchesWildcard("c*t"s, "cart"s));
+    ASSERT(!MatchesWildcard("cat?"s, "cats"s));
+    ASSERT(MatchesWildcard("cat?"s, "cat?"s));
+    ASSERT(MatchesWildcard("c\\*t"s, "c*t"s));
+    ASSERT(!MatchesWildcard("c\\*t"s, "cart"s));
+    ASSERT(MatchesWildcard("a\\**"s, "a*b"s));
+    ASSERT_EQUAL(FindWildcard("a\\*b*"s), 4u);
+    ASSERT_EQUAL(UnescapeWildcard("a\\*b*"s), "a*b*"s);
+
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "cat? c*t"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "cats cart"s, DocumentStatus::ACTUAL, {1});
+    // '?' - обычный символ, экранированная '*' ищется как слово
+    ASSERT(FindIds(search_server, "cat?"s) == vector<int>({1}));
+    ASSERT(FindIds(search_server, "c\\*t"s) == vector<int>({1}));
+    ASSERT(FindIds(search_server, "ca*"s) == vector<int>({1, 2}));
+    ASSERT(FindIds(search_server, "c\\**"s) == vector<int>({1}));
+    const auto [words, status] = search_server.MatchDocument("c\\*t"s, 1);
+    ASSERT(words == vector<string_view>({"c*t"sv}));
+    ASSERT_THROWS(search_server.FindTopDocuments(execution::seq, "*at"s), invalid_argument);
+}
+
+void TestMatchBufferReuse() {
+    const SearchServer search_server = MakeAnimalServer();
+    // слова в буфере ссылаются на текст запроса
+    const string match_query = "cat curly tail"s;
+    const string mask_query = "yellow cat cat -john"s;
+    SearchServer::MatchBuffer buffer;
+    ASSERT(search_server.MatchDocument(match_query, 2, buffer) == DocumentStatus::ACTUAL);
+    ASSERT(buffer.GetMatchedWords() == vector<string_view>({"cat"sv, "curly"sv, "tail"sv}));
+    ASSERT_EQUAL(search_server.MatchDocumentMask(mask_query, 1, buffer), 3u);
+    ASSERT(buffer.GetPlusWords() == vector<string_view>({"cat"sv, "yellow"sv}));
+    ASSERT_EQUAL(search_server.MatchDocumentMask("nasty -john"s, 4, buffer), 0u);
+    search_server.MatchDocument("cat -curly"s, 2, buffer);
+    ASSERT(buffer.GetMatchedWords().empty());
+}
+
+template <typename Scorer>
+void CheckSequentialAndParallelAgree(const SearchServer& search_server, const vector<string>& queries) {
+    for (const string& query : queries) {
+        const auto seq = search_server.FindTopDocuments<Scorer>(execution::seq, query);
+        const auto par = search_server.FindTopDocuments<Scorer>(execution::par, query);
+        ASSERT_EQUAL_HINT(seq.size(), par.size(), query);
+        for (size_t i = 0; i < seq.size(); ++i) {
+            // релевантность сравнивается точно: порядок сложения не должен на неё влиять
+            ASSERT_EQUAL_HINT(seq[i].id, par[i].id, query);
+            ASSERT_HINT(seq[i].relevance == par[i].relevance, query);
+            ASSERT_EQUAL_HINT(seq[i].rating, par[i].rating, query);
+        }
+    }
+}
+
+void TestSequentialAndParallelSearchAgree() {
+    CorpusOptions options;
+    options.document_count = 3000;
+    options.vocabulary_size = 2000;
+    options.query_count = 200;
+    const SyntheticCorpus corpus = GenerateCorpus(options);
+    // плотные id выбирают плотный аккумулятор, редкие - std::map
+    for (const int id_step : {1, 10}) {
+        SearchServer search_server(corpus.stop_words);
+        for (size_t i = 0; i < corpus.documents.size(); ++i) {
+            const int rating = static_cast<int>(i % 7);
+            search_server.AddDocument(static_cast<int>(i) * id_step, corpus.documents[i], DocumentStatus::ACTUAL, {rating});
+        }
+        CheckSequentialAndParallelAgree<TfIdfScorer>(search_server, corpus.queries);
+        CheckSequentialAndParallelAgree<Bm25Scorer>(search_server, corpus.queries);
+    }
+}
+
+struct KernelOutputs {
+    vector<int64_t> accumulator;
+    vector<int32_t> marked;
+    vector<int32_t> selected;
+};
+
+KernelOutputs RunKernels(size_t count, uint32_t seed) {
+    mt19937 generator(seed);
+    // id не повторяются, как требует ScatterAdd
+    vector<int32_t> ids(count);
+    iota(ids.begin(), ids.end(), 0);
+    shuffle(ids.begin(), ids.end(), generator);
+    vector<int64_t> values(count);
+    vector<uint8_t> flags(count);
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = static_cast<int64_t>(generator() % 2'000'000) - 1'000'000;
+        flags[i] = static_cast<uint8_t>(generator() % 3 == 0 ? 0 : generator() % 256);
+    }
+    KernelOutputs outputs;
+    outputs.accumulator.assign(count, 7);
+    ScatterAdd(outputs.accumulator.data(), ids.data(), values.data(), count);
+    outputs.marked.resize(count);
+    outputs.marked.resize(CollectMarked(flags.data(), count, outputs.marked.data()));
+    outputs.selected.resize(count);
+    outputs.selected.resize(SelectAtLeast(values.data(), count, 0, outputs.selected.data()));
+    return outputs;
+}
+
+void TestSimdLevelsMatchScalar() {
+    const vector<size_t> sizes = {0, 1, 3, 7, 8, 16, 33, 65, 1000};
+    SetSimdLevel(SimdLevel::SCALAR);
+    vector<KernelOutputs> expected;
+    for (const size_t size : sizes) {
+        expected.push_back(RunKernels(size, static_cast<uint32_t>(size)));
+    }
+
+    CorpusOptions options;
+    options.document_count = 1000;
+    options.vocabulary_size = 500;
+    options.query_count = 50;
+    const SyntheticCorpus corpus = GenerateCorpus(options);
+    // плотные id выбирают плотный аккумулятор, редкие - std::map
+    SearchServer dense(corpus.stop_words);
+    SearchServer sparse(corpus.stop_words);
+    for (size_t i = 0; i < corpus.documents.size(); ++i) {
+        const int rating = static_cast<int>(i % 7);
+        dense.AddDocument(static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL, {rating});
+        sparse.AddDocument(static_cast<int>(i) * 10, corpus.documents[i], DocumentStatus::ACTUAL, {rating});
+    }
+    QueryProfile dense_profile;
+    QueryProfile sparse_profile;
+    const auto all = [](int, DocumentStatus, int) { return true; };
+    dense.FindTopDocuments(corpus.queries[0], all, dense_profile);
+    sparse.FindTopDocuments(corpus.queries[0], all, sparse_profile);
+    ASSERT(dense_profile.accumulator == Accumulator::DENSE);
+    ASSERT(sparse_profile.accumulator == Accumulator::MAP);
+
+    for (const SimdLevel level : {SimdLevel::SCALAR, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        SetSimdLevel(level);
+        const string hint = GetSimdLevelName(GetSimdLevel());
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            const KernelOutputs actual = RunKernels(sizes[i], static_cast<uint32_t>(sizes[i]));
+            ASSERT_HINT(actual.accumulator == expected[i].accumulator, hint);
+            ASSERT_HINT(actual.marked == expected[i].marked, hint);
+            ASSERT_HINT(actual.selected == expected[i].selected, hint);
+        }
+        for (const string& query : corpus.queries) {
+            const auto dense_result = dense.FindTopDocuments(execution::seq, query);
+            const auto sparse_result = sparse.FindTopDocuments(execution::seq, query);
+            ASSERT_EQUAL_HINT(dense_result.size(), sparse_result.size(), hint + ": "s + query);
+            for (size_t i = 0; i < dense_result.size(); ++i) {
+                ASSERT_EQUAL_HINT(dense_result[i].id * 10, sparse_result[i].id, hint + ": "s + query);
+                ASSERT_HINT(dense_result[i].relevance == sparse_result[i].relevance, hint + ": "s + query);
+            }
+        }
+    }
+    SetSimdLevel(GetSupportedSimdLevel());
+}
+
+void TestPaginationWithNearTies() {
+    // длинные документы с одним "cat" дают почти равные релевантности,
+    // копии с разными рейтингами и id - точно равные
+    // IDF около 1, поэтому соседние длины дают релевантности, отличающиеся примерно на MAX_DIFFERENCE
+    SearchServer search_server("and"s);
+    for (int i = 0; i < 80; ++i) {
+        search_server.AddDocument(1000 + i, "dog"s, DocumentStatus::ACTUAL, {1});
+    }
+    int id = 0;
+    for (int length = 1000; length < 1016; ++length) {
+        string text = "cat"s;
+        for (int i = 1; i < length; ++i) {
+            text += " filler"s + to_string(i % 5);
+        }
+        for (int copy = 0; copy < 3; ++copy) {
+            search_server.AddDocument(id++, text, DocumentStatus::ACTUAL, {copy % 2});
+        }
+    }
+    // соседние кванты релевантности различаются, какой бы ни оказалась их разность в double
+    for (int64_t quantized = 1; quantized < 100'000; ++quantized) {
+        const Document higher{ 1, DequantizeRelevance(quantized + 1), 0 };
+        const Document lower{ 2, DequantizeRelevance(quantized), 5 };
+        ASSERT(IsMoreRelevant(higher, lower));
+        ASSERT(!IsMoreRelevant(lower, higher));
+    }
+
+    const auto all = [](int, DocumentStatus status, int) { return status == DocumentStatus::ACTUAL; };
+    const auto expected = search_server.FindTopDocumentsAfter("cat"s, all, nullopt, 1000);
+    ASSERT_EQUAL(expected.size(), static_cast<size_t>(id));
+    for (size_t i = 1; i < expected.size(); ++i) {
+        ASSERT(IsMoreRelevant(expected[i - 1], expected[i]));
+        ASSERT(!IsMoreRelevant(expected[i], expected[i - 1]));
+    }
+
+    vector<Document> paged;
+    optional<Document> cursor;
+    while (true) {
+        const auto page = search_server.FindTopDocumentsAfter(execution::par, "cat"s, all, cursor, 5);
+        if (page.empty()) {
+            break;
+        }
+        paged.insert(paged.end(), page.begin(), page.end());
+        cursor = page.back();
+    }
+    ASSERT_EQUAL(paged.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQUAL(paged[i].id, expected[i].id);
+    }
+
+    RankedPaginationCache cache(search_server, 5);
+    for (size_t page = 0; page * 5 < expected.size(); ++page) {
+        const auto documents = cache.GetPage("cat"s, page);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            ASSERT_EQUAL(documents[i].id, expected[page * 5 + i].id);
+        }
+    }
+}
+
+void TestAsyncSearchDeadlines() {
+    const SearchServer search_server = MakeAnimalServer();
+    AsyncSearchServer async_server(search_server, 2);
+    const auto now = AsyncSearchServer::Clock::now();
+
+    const SearchResult expired = async_server.FindTopDocuments("curly nasty cat"s, now - chrono::seconds(1)).get();
+    ASSERT(expired.is_partial);
+    ASSERT(expired.documents.empty());
+
+    const auto cancelled = make_shared<atomic<bool>>(true);
+    const SearchResult stopped = async_server.FindTopDocuments("curly nasty cat"s, now + chrono::hours(1), cancelled).get();
+    ASSERT(stopped.is_partial);
+    ASSERT(stopped.documents.empty());
+
+    const SearchResult complete = async_server.FindTopDocuments("curly nasty cat -john"s, now + chrono::hours(1)).get();
+    ASSERT(!complete.is_partial);
+    const auto expected = search_server.FindTopDocuments("curly nasty cat -john"s);
+    ASSERT_EQUAL(complete.documents.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQUAL(complete.documents[i].id, expected[i].id);
+        ASSERT(complete.documents[i].relevance == expected[i].relevance);
+    }
+}
+
+void TestDeadlineKeepsMinusWords() {
+    // документы с dog релевантнее остальных и попали бы в выдачу, если бы минус-слово не применилось
+    const int document_count = 10'000;
+    SearchServer dense("and"s);
+    SearchServer sparse("and"s);
+    for (int id = 0; id < document_count; ++id) {
+        const string text = id % 2 == 0 ? "cat dog"s : "cat bird fish"s;
+        dense.AddDocument(id, text, DocumentStatus::ACTUAL, {1});
+        sparse.AddDocument(id * 10, text, DocumentStatus::ACTUAL, {1});
+    }
+    const auto check = [&](const SearchServer& search_server, auto policy) {
+        atomic<bool> cancelled = false;
+        atomic<int> calls = 0;
+        // запрос отменяется посреди обхода списка cat
+        const auto predicate = [&](int, DocumentStatus, int) {
+            if (++calls == 100) {
+                cancelled = true;
+            }
+            return true;
+        };
+        const QueryDeadline deadline(QueryDeadline::Clock::now() + chrono::hours(1), &cancelled);
+        const auto documents = search_server.FindTopDocuments(policy, "cat -dog"s, predicate, deadline);
+        ASSERT(deadline.IsExpired());
+        ASSERT(calls < document_count);
+        ASSERT(!documents.empty());
+        for (const Document& document : documents) {
+            ASSERT_HINT(get<0>(search_server.MatchDocument("dog"s, document.id)).empty(), to_string(document.id));
+        }
+    };
+    check(dense, execution::seq);
+    check(sparse, execution::seq);
+    check(dense, execution::par);
+}
+
+#ifdef SEARCH_SERVER_METRICS
+uint64_t GetMetricCounter(const string& name) {
+    istringstream snapshot(GetMetricsSnapshot());
+    string line;
+    while (getline(snapshot, line)) {
+        if (line.compare(0, name.size() + 1, name + ' ') == 0) {
+            return stoull(line.substr(name.size() + 1));
+        }
+    }
+    return 0;
+}
+
+void TestMetricsCountScannedPostings() {
+    const SearchServer search_server = MakeAnimalServer();
+    const auto all = [](int, DocumentStatus, int) { return true; };
+    for (const bool parallel : {false, true}) {
+        ResetMetrics();
+        const auto documents = parallel
+            ? search_server.FindTopDocuments(execution::par, "curly nasty cat -john"s, all)
+            : search_server.FindTopDocuments(execution::seq, "curly nasty cat -john"s, all);
+        ASSERT_EQUAL(documents.size(), 3u);
+        // cat - 2 документа, curly - 1, nasty - 2; john исключает документ 4 из четырёх кандидатов
+        ASSERT_EQUAL(GetMetricCounter("postings_scanned"s), 5u);
+        ASSERT_EQUAL(GetMetricCounter("candidates_accumulated"s), 4u);
+        ASSERT_EQUAL(GetMetricCounter("documents_filtered"s), 1u);
+    }
+
+    // отмена посреди списка cat: учитываются только записи до следующей проверки дедлайна,
+    // которая идёт через каждые 1024 записи
+    const int document_count = 3'000;
+    SearchServer dense("and"s);
+    SearchServer sparse("and"s);
+    for (int id = 0; id < document_count; ++id) {
+        dense.AddDocument(id, "cat"s, DocumentStatus::ACTUAL, {1});
+        sparse.AddDocument(id * 10, "cat"s, DocumentStatus::ACTUAL, {1});
+    }
+    const auto check = [&](const SearchServer& search_server, auto policy) {
+        atomic<bool> cancelled = false;
+        const auto predicate = [&](int, DocumentStatus, int) {
+            cancelled = true;
+            return true;
+        };
+        const QueryDeadline deadline(QueryDeadline::Clock::now() + chrono::hours(1), &cancelled);
+        ResetMetrics();
+        search_server.FindTopDocuments(policy, "cat"s, predicate, deadline);
+        ASSERT(deadline.IsExpired());
+        ASSERT_EQUAL(GetMetricCounter("postings_scanned"s), 1024u);
+    };
+    check(dense, execution::seq);
+    check(sparse, execution::seq);
+    check(dense, execution::par);
+}
+#endif
+
+string FrameHeader(uint32_t length) {
+    string header;
+    for (int shift = 0; shift < 32; shift += 8) {
+        header.push_back(static_cast<char>((length >> shift) & 0xFF));
+    }
+    return header;
+}
+
+void TestRequestFrameReader() {
+    string stream;
+    AppendRequest(stream, 0x01020304, "white cat"s);
+    ASSERT_EQUAL(stream, "\x0D\x00\x00\x00\x04\x03\x02\x01white cat"s);
+
+    // кадр, пришедший по одному байту
+    RequestFrameReader reader;
+    QueryRequest request;
+    ASSERT(!reader.HasIncompleteFrame());
+    for (size_t i = 0; i + 1 < stream.size(); ++i) {
+        reader.Append(stream.data() + i, 1);
+        ASSERT(!reader.Next(request));
+        ASSERT(reader.HasIncompleteFrame());
+    }
+    reader.Append(stream.data() + stream.size() - 1, 1);
+    ASSERT(reader.Next(request));
+    ASSERT_EQUAL(request.request_id, 0x01020304u);
+    ASSERT_EQUAL(request.query, "white cat"s);
+    ASSERT(!reader.HasIncompleteFrame());
+    ASSERT(!reader.Next(request));
+
+    // несколько кадров одним куском, последний - не целиком
+    string pipelined;
+    AppendRequest(pipelined, 1, "cat"s);
+    AppendRequest(pipelined, 2, ""s);
+    AppendRequest(pipelined, 3, "dog -cat"s);
+    AppendRequest(pipelined, 4, "tail"s);
+    pipelined.pop_back();
+    reader.Append(pipelined.data(), pipelined.size());
+    const vector<pair<uint32_t, string>> expected = {{1, "cat"s}, {2, ""s}, {3, "dog -cat"s}};
+    for (const auto& [request_id, query] : expected) {
+        ASSERT(reader.Next(request));
+        ASSERT_EQUAL(request.request_id, request_id);
+        ASSERT_EQUAL(request.query, query);
+    }
+    ASSERT(!reader.Next(request));
+    ASSERT(reader.HasIncompleteFrame());
+    reader.Append("l", 1);
+    ASSERT(reader.Next(request));
+    ASSERT_EQUAL(request.query, "tail"s);
+    ASSERT(!reader.HasIncompleteFrame());
+
+    // длина меньше request_id или больше допустимой
+    for (const uint32_t length : {0u, 1u, 3u, MAX_REQUEST_FRAME_SIZE + 1, UINT32_MAX}) {
+        RequestFrameReader bad_reader;
+        const string header = FrameHeader(length);
+        bad_reader.Append(header.data(), header.size());
+        ASSERT_THROWS(bad_reader.Next(request), invalid_argument);
+    }
+    RequestFrameReader largest_reader;
+    const string header = FrameHeader(MAX_REQUEST_FRAME_SIZE);
+    largest_reader.Append(header.data(), header.size());
+    ASSERT(!largest_reader.Next(request));
+    ASSERT(largest_reader.HasIncompleteFrame());
+}
+
+void TestResponseEncoding() {
+    string out;
+    AppendResponse(out, 0x01020304, {{1, 0.5, -2}, {0x0A0B0C0D, -1.0, 7}});
+    const string expected =
+        "\x04\x03\x02\x01" "\x02\x00\x00\x00"s
+        + "\x01\x00\x00\x00"s + "\x00\x00\x00\x00\x00\x00\xE0\x3F"s + "\xFE\xFF\xFF\xFF"s
+        + "\x0D\x0C\x0B\x0A"s + "\x00\x00\x00\x00\x00\x00\xF0\xBF"s + "\x07\x00\x00\x00"s;
+    ASSERT_EQUAL(out, expected);
+
+    out.clear();
+    AppendResponse(out, 5, {});
+    ASSERT_EQUAL(out, "\x05\x00\x00\x00\x00\x00\x00\x00"s);
+
+    // ответы дописываются в конец буфера
+    AppendErrorResponse(out, 7, "bad"s);
+    ASSERT_EQUAL(out, "\x05\x00\x00\x00\x00\x00\x00\x00" "\x07\x00\x00\x00\xFF\xFF\xFF\xFF\x03\x00\x00\x00" "bad"s);
+}
+
+}  // namespace
+
+int main() {
+    RUN_TEST(TestTfIdfKeepsOriginalRelevance);
+    RUN_TEST(TestBm25Relevance);
+    RUN_TEST(TestProfileCountsVisitedPostings);
+    RUN_TEST(TestNumaShardedSearchRethrowsAfterAllShards);
+    RUN_TEST(TestParallelShardedSearchReportsErrors);
+    RUN_TEST(TestShardedWildcardMatchesSingleServer);
+    RUN_TEST(TestMatchDocumentsAgreesWithMatchDocument);
+    RUN_TEST(TestPositionsVarintRoundTrip);
+    RUN_TEST(TestPhraseQueryParsing);
+    RUN_TEST(TestMatchingAppliesPhrases);
+    RUN_TEST(TestProximityQueries);
+    RUN_TEST(TestDuplicateModesKeepSmallestId);
+    RUN_TEST(TestProfileReportsAccumulator);
+    RUN_TEST(TestTermDictionary);
+    RUN_TEST(TestMinusWildcardExcludesAllTerms);
+    RUN_TEST(TestWildcardTermsAreScoredSeparately);
+    RUN_TEST(TestWildcardEscapes);
+    RUN_TEST(TestMatchBufferReuse);
+    RUN_TEST(TestSequentialAndParallelSearchAgree);
+    RUN_TEST(TestSimdLevelsMatchScalar);
+    RUN_TEST(TestPaginationWithNearTies);
+    RUN_TEST(TestAsyncSearchDeadlines);
+    RUN_TEST(TestDeadlineKeepsMinusWords);
+#ifdef SEARCH_SERVER_METRICS
+    RUN_TEST(TestMetricsCountScannedPostings);
+#endif
+    RUN_TEST(TestRequestFrameReader);
+    RUN_TEST(TestResponseEncoding);
+    return 0;
+}
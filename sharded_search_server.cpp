@@ -0,0 +1,122 @@
+#include "sharded_search_server.h"
+
+#include <map>
+#include <set>
+
+using namespace std;
+
+void ShardedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    if (document_id < 0) {
+        throw invalid_argument("Invalid document_id"s);
+    }
+    const size_t shard_index = GetShardIndex(document_id);
+    RunOnShard(shard_index, [&] { shards_[shard_index].AddDocument(document_id, document, status, ratings); });
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    if (document_id < 0) {
+        return;
+    }
+    const size_t shard_index = GetShardIndex(document_id);
+    RunOnShard(shard_index, [&] { shards_[shard_index].RemoveDocument(document_id); });
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(execution::seq, raw_query);
+}
+
+match_type ShardedSearchServer::MatchDocument(string_view raw_query, int document_id) const {
+    if (document_id < 0) {
+        throw out_of_range("Invalid document_id"s);
+    }
+    const size_t shard_index = GetShardIndex(document_id);
+    return RunOnShard(shard_index, [&] { return shards_[shard_index].MatchDocument(raw_query, document_id); });
+}
+
+void ShardedSearchServer::SetDuplicateMode(DuplicateMode mode) {
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        RunOnShard(i, [&] { shards_[i].SetDuplicateMode(mode); });
+    }
+}
+
+void ShardedSearchServer::SetPositionalIndex(bool enabled) {
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        RunOnShard(i, [&] { shards_[i].SetPositionalIndex(enabled); });
+    }
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    int document_count = 0;
+    for (const SearchServer& shard : shards_) {
+        document_count += shard.GetDocumentCount();
+    }
+    return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(size_t index) const {
+    return shards_.at(index);
+}
+
+void ShardedSearchServer::CreateNodePools(size_t shard_count) {
+    const auto nodes = GetNumaNodeCpus();
+    const size_t node_count = min(nodes.size(), shard_count);
+    for (size_t node = 0; node < node_count; ++node) {
+        node_pools_.push_back(make_unique<ThreadPool>(nodes[node].size(), nodes[node]));
+    }
+}
+
+ThreadPool& ShardedSearchServer::GetShardPool(size_t shard_index) const {
+    return *node_pools_[shard_index % node_pools_.size()];
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    return hash<int>{}(document_id) % shards_.size();
+}
+
+SearchServer::CollectionStatistics ShardedSearchServer::ComputeStatistics(string_view raw_query) const {
+    // запрос проверяется здесь, в вызывающем потоке, до рассылки по шардам
+    vector<SearchServer::CollectionStatistics> shard_statistics;
+    shard_statistics.reserve(shards_.size());
+    for (const SearchServer& shard : shards_) {
+        shard_statistics.push_back(shard.GetQueryStatistics(raw_query));
+    }
+
+    // шаблоны раскрываются по объединённому словарю шардов и одинаково для всех шардов;
+    // первые MAX_WILDCARD_EXPANSION слов объединения совпадают с раскрытием по общему словарю
+    map<string, set<string>, less<>> wildcard_terms;
+    for (const auto& shard_statistic : shard_statistics) {
+        for (const auto& [pattern, terms] : shard_statistic.wildcard_expansions) {
+            wildcard_terms[pattern].insert(terms.begin(), terms.end());
+        }
+    }
+    SearchServer::WildcardExpansions expansions;
+    for (const auto& [pattern, terms] : wildcard_terms) {
+        auto& expansion = expansions[pattern];
+        for (auto it = terms.begin(); it != terms.end() && expansion.size() < SearchServer::MAX_WILDCARD_EXPANSION; ++it) {
+            expansion.push_back(*it);
+        }
+    }
+    if (!expansions.empty()) {
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            shard_statistics[i] = shards_[i].GetQueryStatistics(raw_query, &expansions);
+        }
+    }
+
+    SearchServer::CollectionStatistics statistics;
+    for (const auto& shard_statistic : shard_statistics) {
+        statistics.document_count += shard_statistic.document_count;
+        statistics.total_word_count += shard_statistic.total_word_count;
+        for (const auto& [word, document_count] : shard_statistic.word_document_counts) {
+            statistics.word_document_counts[word] += document_count;
+        }
+    }
+    if (statistics.document_count > 0) {
+        statistics.average_document_length = statistics.total_word_count * 1.0 / statistics.document_count;
+    }
+    statistics.wildcard_expansions = move(expansions);
+    return statistics;
+}
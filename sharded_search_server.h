@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <execution>
+#include <future>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "document.h"
+#include "numa_topology.h"
+#include "search_server.h"
+#include "thread_pool.h"
+
+enum class ShardPlacement {
+    // операции шардов выполняются в вызывающем потоке или в потоках execution policy
+    ANY_THREAD,
+    // шарды распределяются по NUMA-узлам по кругу; все операции шарда, включая AddDocument,
+    // выполняет пул потоков, закреплённых за процессорами его узла, поэтому память индекса
+    // шарда выделяется на этом узле (first-touch) и читается без межсокетного трафика
+    NUMA_NODE,
+};
+
+// Делит документы между независимыми шардами SearchServer по хешу id документа.
+// Запрос рассылается во все шарды с общей статистикой коллекции, поэтому релевантность
+// документа не зависит от того, в какой шард он попал, а лучшие результаты шардов
+// сливаются в общий топ
+class ShardedSearchServer {
+public:
+    template <typename StringContainer>
+    ShardedSearchServer(const StringContainer& stop_words, size_t shard_count,
+                        ShardPlacement placement = ShardPlacement::ANY_THREAD) {
+        if (shard_count == 0) {
+            throw std::invalid_argument("Shard count must be positive");
+        }
+        if (placement == ShardPlacement::NUMA_NODE) {
+            CreateNodePools(shard_count);
+        }
+        for (size_t i = 0; i < shard_count; ++i) {
+            if (node_pools_.empty()) {
+                shards_.emplace_back(stop_words);
+            } else {
+                // шард создаётся потоком своего узла, чтобы и его память оказалась там же
+                node_pools_[i % node_pools_.size()]->Submit([&] { shards_.emplace_back(stop_words); }).get();
+            }
+        }
+    }
+
+    ShardedSearchServer(std::string_view stop_words_text, size_t shard_count,
+                        ShardPlacement placement = ShardPlacement::ANY_THREAD)
+        : ShardedSearchServer(SplitIntoWords(stop_words_text), shard_count, placement) {
+    }
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    // При ShardPlacement::NUMA_NODE шарды всегда опрашиваются параллельно пулами своих узлов,
+    // а policy не используется
+    template <typename Scorer = TfIdfScorer, typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
+    template <typename Scorer = TfIdfScorer, typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentStatus status) const;
+    template <typename Scorer = TfIdfScorer, typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    match_type MatchDocument(std::string_view raw_query, int document_id) const;
+
+    // Дубликаты ищутся внутри шарда: документы с одинаковым набором слов из разных шардов не сравниваются
+    void SetDuplicateMode(DuplicateMode mode);
+    void SetPositionalIndex(bool enabled);
+
+    int GetDocumentCount() const;
+    size_t GetShardCount() const;
+    const SearchServer& GetShard(size_t index) const;
+
+private:
+    std::deque<SearchServer> shards_;
+    // пулы потоков по NUMA-узлам, пусто при ShardPlacement::ANY_THREAD
+    std::vector<std::unique_ptr<ThreadPool>> node_pools_;
+
+    void CreateNodePools(size_t shard_count);
+    ThreadPool& GetShardPool(size_t shard_index) const;
+    template <typename Operation>
+    auto RunOnShard(size_t shard_index, Operation operation) const -> decltype(operation());
+
+    size_t GetShardIndex(int document_id) const;
+    SearchServer::CollectionStatistics ComputeStatistics(std::string_view raw_query) const;
+};
+
+template <typename Scorer, typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate) const {
+    const SearchServer::CollectionStatistics statistics = ComputeStatistics(raw_query);
+
+    std::vector<std::vector<Document>> shard_results(shards_.size());
+    if (node_pools_.empty()) {
+        // исключение, вылетевшее из параллельного алгоритма, вызвало бы std::terminate,
+        // поэтому ошибки шардов собираются и первая из них бросается после обхода
+        std::vector<std::exception_ptr> errors(shards_.size());
+        std::vector<size_t> shard_indices(shards_.size());
+        std::iota(shard_indices.begin(), shard_indices.end(), 0);
+        std::for_each(
+            policy,
+            shard_indices.begin(), shard_indices.end(),
+            [&](size_t i) {
+                try {
+                    shard_results[i] = shards_[i].FindTopDocuments<Scorer>(std::execution::seq, raw_query, document_predicate, statistics);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        );
+        for (const std::exception_ptr& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    } else {
+        // задачи ссылаются на локальные переменные этой функции, поэтому выходить из неё,
+        // в том числе с исключением, можно только дождавшись всех отправленных задач
+        std::vector<std::future<std::vector<Document>>> futures;
+        futures.reserve(shards_.size());
+        std::exception_ptr error;
+        try {
+            for (size_t i = 0; i < shards_.size(); ++i) {
+                futures.push_back(GetShardPool(i).Submit([&, i] {
+                    return shards_[i].FindTopDocuments<Scorer>(std::execution::seq, raw_query, document_predicate, statistics);
+                }));
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        for (size_t i = 0; i < futures.size(); ++i) {
+            try {
+                shard_results[i] = futures[i].get();
+            } catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // каждый шард вернул не больше MAX_RESULT_DOCUMENT_COUNT лучших, общий топ - среди них
+    std::vector<Document> matched_documents;
+    for (const auto& documents : shard_results) {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+    }
+    std::sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    return matched_documents;
+}
+
+template <typename Operation>
+auto ShardedSearchServer::RunOnShard(size_t shard_index, Operation operation) const -> decltype(operation()) {
+    if (node_pools_.empty()) {
+        return operation();
+    }
+    return GetShardPool(shard_index).Submit(std::move(operation)).get();
+}
+
+template <typename Scorer, typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments<Scorer>(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == status;
+        });
+}
+
+template <typename Scorer, typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query) const {
+    return FindTopDocuments<Scorer>(policy, raw_query, DocumentStatus::ACTUAL);
+}
@@ -0,0 +1,216 @@
+#include "simd_kernels.h"
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_KERNELS_X86
+#endif
+
+using namespace std;
+
+namespace {
+
+void ScatterAddScalar(int64_t* accumulator, const int32_t* ids, const int64_t* values, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        accumulator[ids[i]] += values[i];
+    }
+}
+
+size_t CollectMarkedScalar(const uint8_t* flags, size_t begin, size_t count, int32_t* out) {
+    size_t found = 0;
+    for (size_t i = begin; i < count; ++i) {
+        if (flags[i]) {
+            out[found++] = static_cast<int32_t>(i);
+        }
+    }
+    return found;
+}
+
+size_t SelectAtLeastScalar(const int64_t* values, size_t begin, size_t count, int64_t threshold, int32_t* out) {
+    size_t found = 0;
+    for (size_t i = begin; i < count; ++i) {
+        if (values[i] >= threshold) {
+            out[found++] = static_cast<int32_t>(i);
+        }
+    }
+    return found;
+}
+
+#ifdef SIMD_KERNELS_X86
+
+// Раскладывает битовую маску в индексы начиная с base
+inline size_t AppendMaskIndices(uint64_t mask, size_t base, int32_t* out) {
+    size_t found = 0;
+    while (mask) {
+        out[found++] = static_cast<int32_t>(base + __builtin_ctzll(mask));
+        mask &= mask - 1;
+    }
+    return found;
+}
+
+__attribute__((target("avx2")))
+void ScatterAddAvx2(int64_t* accumulator, const int32_t* ids, const int64_t* values, size_t count) {
+    // в AVX2 нет scatter: значения собираются и складываются векторно, а записываются по одному
+    size_t i = 0;
+    alignas(32) int64_t sums[4];
+    for (; i + 4 <= count; i += 4) {
+        const __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ids + i));
+        const __m256i current = _mm256_i32gather_epi64(reinterpret_cast<const long long*>(accumulator), index, 8);
+        const __m256i added = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(sums), _mm256_add_epi64(current, added));
+        accumulator[ids[i]] = sums[0];
+        accumulator[ids[i + 1]] = sums[1];
+        accumulator[ids[i + 2]] = sums[2];
+        accumulator[ids[i + 3]] = sums[3];
+    }
+    ScatterAddScalar(accumulator, ids + i, values + i, count - i);
+}
+
+__attribute__((target("avx2")))
+size_t CollectMarkedAvx2(const uint8_t* flags, size_t count, int32_t* out) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t found = 0;
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(flags + i));
+        const uint32_t zero_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, zero)));
+        found += AppendMaskIndices(~zero_mask, i, out + found);
+    }
+    return found + CollectMarkedScalar(flags, i, count, out + found);
+}
+
+__attribute__((target("avx2")))
+size_t SelectAtLeastAvx2(const int64_t* values, size_t count, int64_t threshold, int32_t* out) {
+    const __m256i limit = _mm256_set1_epi64x(threshold);
+    size_t found = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        // value >= threshold <=> !(threshold > value)
+        const uint32_t below = static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(limit, chunk))));
+        found += AppendMaskIndices(~below & 0xF, i, out + found);
+    }
+    return found + SelectAtLeastScalar(values, i, count, threshold, out + found);
+}
+
+__attribute__((target("avx512f")))
+void ScatterAddAvx512(int64_t* accumulator, const int32_t* ids, const int64_t* values, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids + i));
+        const __m512i current = _mm512_mask_i32gather_epi64(_mm512_setzero_si512(), 0xFF, index, accumulator, 8);
+        const __m512i added = _mm512_loadu_si512(values + i);
+        _mm512_i32scatter_epi64(accumulator, index, _mm512_add_epi64(current, added), 8);
+    }
+    ScatterAddScalar(accumulator, ids + i, values + i, count - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+size_t CollectMarkedAvx512(const uint8_t* flags, size_t count, int32_t* out) {
+    size_t found = 0;
+    size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        const __m512i chunk = _mm512_loadu_si512(flags + i);
+        found += AppendMaskIndices(_mm512_test_epi8_mask(chunk, chunk), i, out + found);
+    }
+    return found + CollectMarkedScalar(flags, i, count, out + found);
+}
+
+__attribute__((target("avx512f,avx512vl")))
+size_t SelectAtLeastAvx512(const int64_t* values, size_t count, int64_t threshold, int32_t* out) {
+    const __m512i limit = _mm512_set1_epi64(threshold);
+    const __m256i step = _mm256_set1_epi32(8);
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    size_t found = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __mmask8 mask = _mm512_cmpge_epi64_mask(_mm512_loadu_si512(values + i), limit);
+        _mm256_mask_compressstoreu_epi32(out + found, mask, index);
+        found += static_cast<size_t>(__builtin_popcount(mask));
+        index = _mm256_add_epi32(index, step);
+    }
+    return found + SelectAtLeastScalar(values, i, count, threshold, out + found);
+}
+
+#endif
+
+SimdLevel DetectSimdLevel() {
+#ifdef SIMD_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+#endif
+    return SimdLevel::SCALAR;
+}
+
+const SimdLevel supported_level = DetectSimdLevel();
+atomic<SimdLevel> active_level{ supported_level };
+
+}  // namespace
+
+SimdLevel GetSupportedSimdLevel() {
+    return supported_level;
+}
+
+SimdLevel GetSimdLevel() {
+    return active_level.load(memory_order_relaxed);
+}
+
+void SetSimdLevel(SimdLevel level) {
+    active_level.store(level < supported_level ? level : supported_level, memory_order_relaxed);
+}
+
+const char* GetSimdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::AVX512:
+        return "avx512";
+    case SimdLevel::AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+void ScatterAdd(int64_t* accumulator, const int32_t* ids, const int64_t* values, size_t count) {
+    switch (GetSimdLevel()) {
+#ifdef SIMD_KERNELS_X86
+    case SimdLevel::AVX512:
+        return ScatterAddAvx512(accumulator, ids, values, count);
+    case SimdLevel::AVX2:
+        return ScatterAddAvx2(accumulator, ids, values, count);
+#endif
+    default:
+        return ScatterAddScalar(accumulator, ids, values, count);
+    }
+}
+
+size_t CollectMarked(const uint8_t* flags, size_t count, int32_t* out) {
+    switch (GetSimdLevel()) {
+#ifdef SIMD_KERNELS_X86
+    case SimdLevel::AVX512:
+        return CollectMarkedAvx512(flags, count, out);
+    case SimdLevel::AVX2:
+        return CollectMarkedAvx2(flags, count, out);
+#endif
+    default:
+        return CollectMarkedScalar(flags, 0, count, out);
+    }
+}
+
+size_t SelectAtLeast(const int64_t* values, size_t count, int64_t threshold, int32_t* out) {
+    switch (GetSimdLevel()) {
+#ifdef SIMD_KERNELS_X86
+    case SimdLevel::AVX512:
+        return SelectAtLeastAvx512(values, count, threshold, out);
+    case SimdLevel::AVX2:
+        return SelectAtLeastAvx2(values, count, threshold, out);
+#endif
+    default:
+        return SelectAtLeastScalar(values, 0, count, threshold, out);
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Векторные ядра поиска. Реализация (AVX-512, AVX2 или скалярная) выбирается
+// во время выполнения по возможностям процессора
+enum class SimdLevel {
+    SCALAR,
+    AVX2,
+    AVX512,
+};
+
+SimdLevel GetSupportedSimdLevel();
+SimdLevel GetSimdLevel();
+// Ограничивает используемый набор инструкций, например для сравнения со скалярной версией.
+// Уровень выше поддерживаемого процессором понижается до поддерживаемого
+void SetSimdLevel(SimdLevel level);
+const char* GetSimdLevelName(SimdLevel level);
+
+// accumulator[ids[i]] += values[i]. Внутри одного вызова ids не должны повторяться
+void ScatterAdd(int64_t* accumulator, const int32_t* ids, const int64_t* values, size_t count);
+
+// Записывает в out индексы ненулевых флагов и возвращает их число. out должен вмещать count значений
+size_t CollectMarked(const uint8_t* flags, size_t count, int32_t* out);
+
+// Записывает в out индексы значений, не меньших threshold, и возвращает их число
+size_t SelectAtLeast(const int64_t* values, size_t count, int64_t threshold, int32_t* out);
@@ -4,9 +4,15 @@ using namespace std;
 
 vector<string_view> SplitIntoWords(string_view str) {
     vector<string_view> result;
+    SplitIntoWords(str, result);
+    return result;
+}
+
+void SplitIntoWords(string_view str, vector<string_view>& result) {
+    result.clear();
     int64_t not_space = str.find_first_not_of(' ');
     if(not_space == -1) {
-        return result;
+        return;
     }
     str.remove_prefix(not_space);
     const int64_t pos_end = str.npos;
@@ -20,6 +26,55 @@ vector<string_view> SplitIntoWords(string_view str) {
             str.remove_prefix(min(str.size(), str.find_first_of(' ')));
         }
     }
+}
+
+bool MatchesWildcard(string_view pattern, string_view word) {
+    size_t p = 0;
+    size_t w = 0;
+    // позиция последней '*' в шаблоне и слова, с которой она начала совпадать
+    size_t star = pattern.npos;
+    size_t star_word = 0;
+    while (w < word.size()) {
+        const bool escaped = p + 1 < pattern.size() && pattern[p] == '\\' && pattern[p + 1] == '*';
+        if (p < pattern.size() && !escaped && pattern[p] == '*') {
+            star = p++;
+            star_word = w;
+        } else if (p < pattern.size() && (escaped ? word[w] == '*' : pattern[p] == word[w])) {
+            p += escaped ? 2 : 1;
+            ++w;
+        } else if (star != pattern.npos) {
+            // '*' поглощает ещё один символ слова
+            p = star + 1;
+            w = ++star_word;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+size_t FindWildcard(string_view pattern) {
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] == '\\' && i + 1 < pattern.size() && pattern[i + 1] == '*') {
+            ++i;
+        } else if (pattern[i] == '*') {
+            return i;
+        }
+    }
+    return pattern.npos;
+}
 
+string UnescapeWildcard(string_view pattern) {
+    string result;
+    result.reserve(pattern.size());
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] == '\\' && i + 1 < pattern.size() && pattern[i + 1] == '*') {
+            ++i;
+        }
+        result.push_back(pattern[i]);
+    }
     return result;
 }
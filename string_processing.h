@@ -5,6 +5,15 @@
 #include <deque>
 
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
+// Заполняет words заново, переиспользуя уже выделенную память
+void SplitIntoWords(std::string_view text, std::vector<std::string_view>& words);
+
+// Сопоставление с шаблоном: '*' - любая последовательность символов, "\\*" - сам символ '*'
+bool MatchesWildcard(std::string_view pattern, std::string_view word);
+// Позиция первой неэкранированной '*' или npos
+size_t FindWildcard(std::string_view pattern);
+// Заменяет "\\*" на '*'
+std::string UnescapeWildcard(std::string_view pattern);
 
 template <typename StringContainer>
 std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
@@ -0,0 +1,106 @@
+#include "synthetic_corpus.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+using namespace std;
+
+ZipfDistribution::ZipfDistribution(size_t size, double exponent)
+    : cumulative_(size) {
+    double sum = 0.0;
+    for (size_t i = 0; i < size; ++i) {
+        sum += 1.0 / pow(static_cast<double>(i + 1), exponent);
+        cumulative_[i] = sum;
+    }
+    for (double& value : cumulative_) {
+        value /= sum;
+    }
+}
+
+size_t ZipfDistribution::operator()(mt19937& generator) const {
+    const double value = uniform_real_distribution<double>(0.0, 1.0)(generator);
+    const auto it = lower_bound(cumulative_.begin(), cumulative_.end(), value);
+    return min(static_cast<size_t>(it - cumulative_.begin()), cumulative_.size() - 1);
+}
+
+static vector<string> GenerateDictionary(size_t size, mt19937& generator) {
+    uniform_int_distribution<int> length_distribution(3, 10);
+    uniform_int_distribution<int> letter_distribution('a', 'z');
+    set<string> words;
+    while (words.size() < size) {
+        string word(length_distribution(generator), ' ');
+        for (char& c : word) {
+            c = static_cast<char>(letter_distribution(generator));
+        }
+        words.insert(move(word));
+    }
+    vector<string> dictionary(words.begin(), words.end());
+    shuffle(dictionary.begin(), dictionary.end(), generator);
+    return dictionary;
+}
+
+static string JoinWords(const vector<string_view>& words) {
+    string text;
+    for (string_view word : words) {
+        if (!text.empty()) {
+            text += ' ';
+        }
+        text += word;
+    }
+    return text;
+}
+
+SyntheticCorpus GenerateCorpus(const CorpusOptions& options) {
+    mt19937 generator(options.seed);
+    const vector<string> dictionary = GenerateDictionary(options.vocabulary_size, generator);
+    const ZipfDistribution zipf(dictionary.size(), options.zipf_exponent);
+    bernoulli_distribution is_duplicate(options.duplicate_ratio);
+    bernoulli_distribution is_minus(options.minus_word_ratio);
+
+    SyntheticCorpus corpus;
+    // самые частые слова становятся стоп-словами, как в реальных текстах
+    for (size_t i = 0; i < min<size_t>(5, dictionary.size()); ++i) {
+        corpus.stop_words.push_back(dictionary[i]);
+    }
+
+    vector<string_view> words;
+    corpus.documents.reserve(options.document_count);
+    for (size_t i = 0; i < options.document_count; ++i) {
+        if (!corpus.documents.empty() && is_duplicate(generator)) {
+            // тот же набор слов в другом порядке
+            const size_t original = uniform_int_distribution<size_t>(0, corpus.documents.size() - 1)(generator);
+            string text = corpus.documents[original];
+            words.clear();
+            for (size_t begin = 0; begin < text.size();) {
+                const size_t end = min(text.find(' ', begin), text.size());
+                words.push_back(string_view(text).substr(begin, end - begin));
+                begin = end + 1;
+            }
+            reverse(words.begin(), words.end());
+            corpus.documents.push_back(JoinWords(words));
+            continue;
+        }
+        words.clear();
+        for (size_t j = 0; j < options.document_length; ++j) {
+            words.push_back(dictionary[zipf(generator)]);
+        }
+        corpus.documents.push_back(JoinWords(words));
+    }
+
+    corpus.queries.reserve(options.query_count);
+    for (size_t i = 0; i < options.query_count; ++i) {
+        string query;
+        for (size_t j = 0; j < options.query_word_count; ++j) {
+            if (!query.empty()) {
+                query += ' ';
+            }
+            if (is_minus(generator)) {
+                query += '-';
+            }
+            query += dictionary[zipf(generator)];
+        }
+        corpus.queries.push_back(move(query));
+    }
+    return corpus;
+}
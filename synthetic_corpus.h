@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Параметры синтетического корпуса для бенчмарков. Слова документов и запросов
+// выбираются из словаря по закону Ципфа, как в естественных текстах
+struct CorpusOptions {
+    size_t document_count = 10000;
+    size_t vocabulary_size = 20000;
+    size_t document_length = 50;
+    size_t query_count = 1000;
+    size_t query_word_count = 3;
+    double minus_word_ratio = 0.1;   // доля минус-слов в запросе
+    double duplicate_ratio = 0.05;   // доля документов, повторяющих набор слов более раннего
+    double zipf_exponent = 1.0;
+    uint32_t seed = 42;
+};
+
+struct SyntheticCorpus {
+    std::vector<std::string> stop_words;
+    std::vector<std::string> documents;
+    std::vector<std::string> queries;
+};
+
+// Генератор индексов [0, size) с вероятностью, обратно пропорциональной (index + 1)^exponent
+class ZipfDistribution {
+public:
+    ZipfDistribution(size_t size, double exponent);
+
+    size_t operator()(std::mt19937& generator) const;
+
+private:
+    std::vector<double> cumulative_;
+};
+
+SyntheticCorpus GenerateCorpus(const CorpusOptions& options);
@@ -0,0 +1,160 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+static void AppendVarint(string& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static uint32_t ReadVarint(const string& data, size_t& offset) {
+    uint32_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        const auto byte = static_cast<unsigned char>(data[offset++]);
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+}
+
+FrontCodedDictionary::FrontCodedDictionary(const vector<string_view>& terms, const vector<uint32_t>& values)
+    : values_(values) {
+    if (terms.size() != values.size()) {
+        throw invalid_argument("Each term needs exactly one value"s);
+    }
+    string_view previous;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        const string_view term = terms[i];
+        if (i > 0 && term <= previous) {
+            throw invalid_argument("Terms must be sorted and unique"s);
+        }
+        if (i % BLOCK_SIZE == 0) {
+            block_offsets_.push_back(static_cast<uint32_t>(data_.size()));
+            AppendVarint(data_, static_cast<uint32_t>(term.size()));
+            data_.append(term);
+        } else {
+            const size_t shared = mismatch(previous.begin(), previous.end(), term.begin(), term.end()).first - previous.begin();
+            AppendVarint(data_, static_cast<uint32_t>(shared));
+            AppendVarint(data_, static_cast<uint32_t>(term.size() - shared));
+            data_.append(term.substr(shared));
+        }
+        previous = term;
+    }
+    data_.shrink_to_fit();
+}
+
+size_t FrontCodedDictionary::size() const {
+    return values_.size();
+}
+
+optional<uint32_t> FrontCodedDictionary::Find(string_view term) const {
+    optional<uint32_t> result;
+    if (values_.empty()) {
+        return result;
+    }
+    Scan(FindBlock(term), [&](string_view current, size_t index) {
+        if (current == term) {
+            result = values_[index];
+        }
+        return current < term;
+    });
+    return result;
+}
+
+vector<pair<string, uint32_t>> FrontCodedDictionary::Complete(string_view prefix, size_t limit) const {
+    vector<pair<string, uint32_t>> completions;
+    if (values_.empty() || limit == 0) {
+        return completions;
+    }
+    // термины идут по алфавиту, поэтому при равных значениях меньший индекс лучше
+    const auto better = [&](size_t lhs, size_t rhs) {
+        return values_[lhs] != values_[rhs] ? values_[lhs] > values_[rhs] : lhs < rhs;
+    };
+    // куча из лучших limit индексов, худший из них на вершине; строки собираются только для них
+    vector<size_t> best;
+    Scan(FindBlock(prefix), [&](string_view term, size_t index) {
+        if (term.substr(0, prefix.size()) != prefix) {
+            return term < prefix;
+        }
+        if (best.size() < limit) {
+            best.push_back(index);
+            push_heap(best.begin(), best.end(), better);
+        } else if (better(index, best.front())) {
+            pop_heap(best.begin(), best.end(), better);
+            best.back() = index;
+            push_heap(best.begin(), best.end(), better);
+        }
+        return true;
+    });
+    sort_heap(best.begin(), best.end(), better);
+    completions.reserve(best.size());
+    for (const size_t index : best) {
+        completions.emplace_back(GetTerm(index), values_[index]);
+    }
+    return completions;
+}
+
+size_t FrontCodedDictionary::GetMemoryUsage() const {
+    return data_.capacity() + block_offsets_.capacity() * sizeof(uint32_t) + values_.capacity() * sizeof(uint32_t);
+}
+
+string_view FrontCodedDictionary::GetBlockHead(size_t block) const {
+    size_t offset = block_offsets_[block];
+    const uint32_t length = ReadVarint(data_, offset);
+    return string_view(data_).substr(offset, length);
+}
+
+string FrontCodedDictionary::GetTerm(size_t index) const {
+    string result;
+    Scan(index / BLOCK_SIZE, [&](string_view term, size_t current) {
+        if (current == index) {
+            result = term;
+            return false;
+        }
+        return true;
+    });
+    return result;
+}
+
+size_t FrontCodedDictionary::FindBlock(string_view key) const {
+    size_t left = 0;
+    size_t right = block_offsets_.size();
+    while (right - left > 1) {
+        const size_t middle = (left + right) / 2;
+        if (GetBlockHead(middle) <= key) {
+            left = middle;
+        } else {
+            right = middle;
+        }
+    }
+    return left;
+}
+
+template <typename Visitor>
+void FrontCodedDictionary::Scan(size_t block, Visitor visitor) const {
+    string term;
+    size_t offset = block_offsets_[block];
+    for (size_t index = block * BLOCK_SIZE; index < values_.size(); ++index) {
+        if (index % BLOCK_SIZE == 0) {
+            const uint32_t length = ReadVarint(data_, offset);
+            term.assign(data_, offset, length);
+            offset += length;
+        } else {
+            const uint32_t shared = ReadVarint(data_, offset);
+            const uint32_t suffix_length = ReadVarint(data_, offset);
+            term.resize(shared);
+            term.append(data_, offset, suffix_length);
+            offset += suffix_length;
+        }
+        if (!visitor(string_view(term), index)) {
+            return;
+        }
+    }
+}
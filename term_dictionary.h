@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Неизменяемый сжатый словарь терминов (front coding). Термины хранятся по возрастанию
+// блоками по BLOCK_SIZE: первый термин блока целиком, остальные - длиной общего
+// с предыдущим термином префикса и оставшимся суффиксом. Поиск начинается с двоичного
+// поиска по первым терминам блоков. Каждому термину сопоставлено число, например
+// число содержащих его документов
+class FrontCodedDictionary {
+public:
+    FrontCodedDictionary() = default;
+    // terms должны быть отсортированы по возрастанию и не повторяться
+    FrontCodedDictionary(const std::vector<std::string_view>& terms, const std::vector<uint32_t>& values);
+
+    size_t size() const;
+    std::optional<uint32_t> Find(std::string_view term) const;
+    // Автодополнение: до limit терминов с префиксом prefix по убыванию значения, при равных - по алфавиту
+    std::vector<std::pair<std::string, uint32_t>> Complete(std::string_view prefix, size_t limit) const;
+    size_t GetMemoryUsage() const;
+
+private:
+    static const size_t BLOCK_SIZE = 16;
+
+    std::string data_;
+    std::vector<uint32_t> block_offsets_;
+    std::vector<uint32_t> values_;
+
+    std::string_view GetBlockHead(size_t block) const;
+    std::string GetTerm(size_t index) const;
+    // Последний блок, первый термин которого не больше key
+    size_t FindBlock(std::string_view key) const;
+    // Вызывает visitor(term, index) для терминов начиная с блока block, пока visitor возвращает true
+    template <typename Visitor>
+    void Scan(size_t block, Visitor visitor) const;
+};
@@ -0,0 +1,46 @@
+#include "thread_pool.h"
+
+#include "numa_topology.h"
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t thread_count, const vector<int>& cpus) {
+    threads_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back([this, cpus] { Run(cpus); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    has_tasks_.notify_all();
+    for (thread& worker : threads_) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::GetThreadCount() const {
+    return threads_.size();
+}
+
+void ThreadPool::Run(const vector<int>& cpus) {
+    if (!cpus.empty()) {
+        PinCurrentThread(cpus);
+    }
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock lock(mutex_);
+            has_tasks_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с общей очередью задач. Потоки можно закрепить за набором процессоров,
+// например за процессорами одного NUMA-узла
+class ThreadPool {
+public:
+    // cpus - процессоры для закрепления потоков; пустой список - без закрепления
+    explicit ThreadPool(size_t thread_count, const std::vector<int>& cpus = {});
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template <typename Task>
+    auto Submit(Task task) -> std::future<decltype(task())>;
+
+    size_t GetThreadCount() const;
+
+private:
+    std::mutex mutex_;
+    std::condition_variable has_tasks_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+
+    void Run(const std::vector<int>& cpus);
+};
+
+template <typename Task>
+auto ThreadPool::Submit(Task task) -> std::future<decltype(task())> {
+    using Result = decltype(task());
+    // std::function требует копируемости, поэтому packaged_task хранится через shared_ptr
+    auto packaged_task = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+    auto result = packaged_task->get_future();
+    {
+        std::lock_guard guard(mutex_);
+        tasks_.push_back([packaged_task] { (*packaged_task)(); });
+    }
+    has_tasks_.notify_one();
+    return result;
+}